@@ -0,0 +1,350 @@
+/**********************************************************
+ * Name:
+ *     q2_bench.c
+ *
+ * Description:
+ *     Benchmarks for power of two queue. Results are written
+ *     to stdout as CSV, one row per measurement.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#define _GNU_SOURCE
+#include "q2.h"
+#include "q2_spsc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define BENCH_TARGET_BYTES      (256u * 1024u * 1024u)
+#define BENCH_MIN_OPS           (1u << 16)
+#define BENCH_MAX_OPS           (1u << 24)
+#define BENCH_MAX_BUFFER_BYTES  (64u * 1024u * 1024u)
+#define BENCH_BATCH_CAPACITY    (1024)
+#define BENCH_PING_PONG_ROUNDS  (200000)
+#define BENCH_PING_PONG_WARMUP  (10000)
+#define BENCH_SPSC_OPS          (1u << 24)
+#define BENCH_SPSC_CAPACITY     (1024)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    q2_spsc_context_t* ping;
+    q2_spsc_context_t* pong;
+    uint32_t rounds;
+    int cpu;
+} bench_thread_args_t;
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static const uint32_t bench_item_sizes[] = { 1, 8, 16, 64, 256, 1024, 4096 };
+static const uint32_t bench_capacities[] = { 16, 1024, 16384 };
+static const uint32_t bench_batch_sizes[] = { 1, 8, 64, 512 };
+
+Q2_SPSC(bench_ping, uint64_t, 16);
+Q2_SPSC(bench_pong, uint64_t, 16);
+Q2_SPSC(bench_stream, uint64_t, BENCH_SPSC_CAPACITY);
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_pin(int cpu)
+{
+    cpu_set_t set;
+
+    if(cpu >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        /* Best effort, unpinned numbers are still reported */
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+}
+
+static void bench_print_header(void)
+{
+    printf("benchmark,item_size,capacity,batch,ops,ns_per_op,mops_per_sec,p50_ns,p99_ns,p999_ns\n");
+}
+
+static void bench_print_throughput(const char* name, uint32_t item_size, uint32_t capacity, uint32_t batch, uint64_t ops, uint64_t elapsed_ns)
+{
+    double ns_per_op = (double)elapsed_ns / (double)ops;
+    printf("%s,%u,%u,%u,%llu,%.3f,%.3f,,,\n", name, item_size, capacity, batch,
+           (unsigned long long)ops, ns_per_op, 1000.0 / ns_per_op);
+}
+
+static uint32_t bench_ops_for(uint32_t item_size)
+{
+    uint32_t ops = BENCH_TARGET_BYTES / item_size;
+
+    if(ops < BENCH_MIN_OPS)
+    {
+        ops = BENCH_MIN_OPS;
+    }
+    else if(ops > BENCH_MAX_OPS)
+    {
+        ops = BENCH_MAX_OPS;
+    }
+
+    return ops;
+}
+
+static void bench_context_setup(q2_context_t* const ctx, void* const data, uint32_t item_size, uint32_t capacity)
+{
+    memset(ctx, 0x00, sizeof(*ctx));
+    ctx->data = data;
+    ctx->max_length = capacity;
+    ctx->item_length = item_size;
+    (void)q2_init(ctx);
+}
+
+/* Fill then drain the queue until ops puts and ops gets have been done */
+static void bench_single_thread(void)
+{
+    q2_context_t ctx;
+    uint8_t* data;
+    uint8_t* item;
+    uint32_t s;
+    uint32_t c;
+    uint32_t i;
+    uint32_t done;
+    uint32_t ops;
+    uint64_t start;
+
+    item = calloc(1, bench_item_sizes[(sizeof(bench_item_sizes) / sizeof(bench_item_sizes[0])) - 1]);
+
+    for(s = 0; s < sizeof(bench_item_sizes) / sizeof(bench_item_sizes[0]); s++)
+    {
+        for(c = 0; c < sizeof(bench_capacities) / sizeof(bench_capacities[0]); c++)
+        {
+            if(((uint64_t)bench_item_sizes[s] * bench_capacities[c]) > BENCH_MAX_BUFFER_BYTES)
+            {
+                continue;
+            }
+
+            data = calloc(bench_capacities[c], bench_item_sizes[s]);
+            bench_context_setup(&ctx, data, bench_item_sizes[s], bench_capacities[c]);
+            ops = bench_ops_for(bench_item_sizes[s]);
+
+            start = bench_now_ns();
+            for(done = 0; done < ops; done += bench_capacities[c])
+            {
+                for(i = 0; i < bench_capacities[c]; i++)
+                {
+                    (void)q2_put(&ctx, item);
+                }
+                for(i = 0; i < bench_capacities[c]; i++)
+                {
+                    (void)q2_get(&ctx, item);
+                }
+            }
+            bench_print_throughput("put_get", bench_item_sizes[s], bench_capacities[c], 1, 2ull * done, bench_now_ns() - start);
+
+            free(data);
+        }
+    }
+
+    free(item);
+}
+
+/* Compare per item put/get against put_n/get_n for the same traffic */
+static void bench_batch(void)
+{
+    q2_context_t ctx;
+    uint8_t* data;
+    uint8_t* items;
+    uint32_t s;
+    uint32_t b;
+    uint32_t i;
+    uint32_t done;
+    uint32_t ops;
+    uint32_t batch;
+    uint32_t transferred;
+    uint64_t start;
+
+    items = calloc(BENCH_BATCH_CAPACITY, bench_item_sizes[(sizeof(bench_item_sizes) / sizeof(bench_item_sizes[0])) - 1]);
+
+    for(s = 0; s < sizeof(bench_item_sizes) / sizeof(bench_item_sizes[0]); s++)
+    {
+        data = calloc(BENCH_BATCH_CAPACITY, bench_item_sizes[s]);
+        ops = bench_ops_for(bench_item_sizes[s]);
+
+        for(b = 0; b < sizeof(bench_batch_sizes) / sizeof(bench_batch_sizes[0]); b++)
+        {
+            batch = bench_batch_sizes[b];
+
+            bench_context_setup(&ctx, data, bench_item_sizes[s], BENCH_BATCH_CAPACITY);
+            start = bench_now_ns();
+            for(done = 0; done < ops; done += batch)
+            {
+                for(i = 0; i < batch; i++)
+                {
+                    (void)q2_put(&ctx, items + (i * bench_item_sizes[s]));
+                }
+                for(i = 0; i < batch; i++)
+                {
+                    (void)q2_get(&ctx, items + (i * bench_item_sizes[s]));
+                }
+            }
+            bench_print_throughput("per_item", bench_item_sizes[s], BENCH_BATCH_CAPACITY, batch, 2ull * done, bench_now_ns() - start);
+
+            bench_context_setup(&ctx, data, bench_item_sizes[s], BENCH_BATCH_CAPACITY);
+            start = bench_now_ns();
+            for(done = 0; done < ops; done += batch)
+            {
+                (void)q2_put_n(&ctx, items, batch, false, &transferred);
+                (void)q2_get_n(&ctx, items, batch, false, &transferred);
+            }
+            bench_print_throughput("batch", bench_item_sizes[s], BENCH_BATCH_CAPACITY, batch, 2ull * done, bench_now_ns() - start);
+        }
+
+        free(data);
+    }
+
+    free(items);
+}
+
+static void* bench_echo_thread(void* arg)
+{
+    bench_thread_args_t* args = arg;
+    uint64_t value;
+    uint32_t i;
+
+    bench_pin(args->cpu);
+
+    for(i = 0; i < args->rounds; i++)
+    {
+        while(Q2_SUCCESS != q2_spsc_get(args->ping, &value));
+        while(Q2_SUCCESS != q2_spsc_put(args->pong, &value));
+    }
+
+    return NULL;
+}
+
+/* Round trip latency between two pinned threads over two spsc queues */
+static void bench_ping_pong(void)
+{
+    bench_thread_args_t args;
+    pthread_t echo;
+    uint64_t* samples;
+    uint64_t value;
+    uint64_t start;
+    uint32_t rounds = BENCH_PING_PONG_WARMUP + BENCH_PING_PONG_ROUNDS;
+    uint32_t i;
+
+    samples = malloc(BENCH_PING_PONG_ROUNDS * sizeof(uint64_t));
+    (void)q2_spsc_init(&bench_ping);
+    (void)q2_spsc_init(&bench_pong);
+
+    args.ping = &bench_ping;
+    args.pong = &bench_pong;
+    args.rounds = rounds;
+    args.cpu = 1;
+    bench_pin(0);
+    pthread_create(&echo, NULL, bench_echo_thread, &args);
+
+    for(i = 0; i < rounds; i++)
+    {
+        value = i;
+        start = bench_now_ns();
+        while(Q2_SUCCESS != q2_spsc_put(&bench_ping, &value));
+        while(Q2_SUCCESS != q2_spsc_get(&bench_pong, &value));
+        if(i >= BENCH_PING_PONG_WARMUP)
+        {
+            samples[i - BENCH_PING_PONG_WARMUP] = bench_now_ns() - start;
+        }
+    }
+    pthread_join(echo, NULL);
+
+    qsort(samples, BENCH_PING_PONG_ROUNDS, sizeof(uint64_t), bench_compare_u64);
+    printf("spsc_ping_pong_rtt,%u,%u,1,%u,,,%llu,%llu,%llu\n",
+           (uint32_t)sizeof(uint64_t), 16u, BENCH_PING_PONG_ROUNDS,
+           (unsigned long long)samples[BENCH_PING_PONG_ROUNDS / 2],
+           (unsigned long long)samples[(BENCH_PING_PONG_ROUNDS * 99ull) / 100],
+           (unsigned long long)samples[(BENCH_PING_PONG_ROUNDS * 999ull) / 1000]);
+
+    free(samples);
+}
+
+static void* bench_stream_producer(void* arg)
+{
+    uint64_t value;
+    (void)arg;
+
+    bench_pin(1);
+
+    for(value = 0; value < BENCH_SPSC_OPS; value++)
+    {
+        while(Q2_SUCCESS != q2_spsc_put(&bench_stream, &value));
+    }
+
+    return NULL;
+}
+
+/* Streaming throughput between two pinned threads */
+static void bench_spsc_stream(void)
+{
+    pthread_t producer;
+    uint64_t value;
+    uint64_t start;
+    uint32_t i;
+
+    (void)q2_spsc_init(&bench_stream);
+    bench_pin(0);
+
+    start = bench_now_ns();
+    pthread_create(&producer, NULL, bench_stream_producer, NULL);
+    for(i = 0; i < BENCH_SPSC_OPS; i++)
+    {
+        while(Q2_SUCCESS != q2_spsc_get(&bench_stream, &value));
+    }
+    pthread_join(producer, NULL);
+
+    bench_print_throughput("spsc_stream", sizeof(uint64_t), BENCH_SPSC_CAPACITY, 1, BENCH_SPSC_OPS, bench_now_ns() - start);
+}
+
+int main(void)
+{
+    bench_print_header();
+    bench_single_thread();
+    bench_batch();
+
+    /* Spinning threads sharing one core only measure the scheduler */
+    if(sysconf(_SC_NPROCESSORS_ONLN) >= 2)
+    {
+        bench_spsc_stream();
+        bench_ping_pong();
+    }
+    else
+    {
+        fprintf(stderr, "q2_bench: fewer than 2 cpus online, skipping threaded benchmarks\n");
+    }
+
+    return 0;
+}
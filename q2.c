@@ -13,6 +13,81 @@
 #include "q2.h"
 #include <string.h>
 
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_used
+ *
+ * Description:
+ *    Returns the number of items currently in the queue.
+ *
+ * Parameters:
+ *    const q2_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Number of queued items.
+ *********************************************************/
+static uint32_t q2_used(const q2_context_t* const ctx)
+{
+    return ctx->head - ctx->tail;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_advance_head
+ *
+ * Description:
+ *    Moves the head index forward over count items that
+ *    have been written. Caller must ensure count items are
+ *    free.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items written.
+ *********************************************************/
+static void q2_advance_head(q2_context_t* const ctx, uint32_t count)
+{
+    if(count > 0)
+    {
+        Q2_SOJOURN_STAMP(ctx, ctx->head, count);
+        ctx->head += count;
+
+        Q2_STATS_ADD(ctx, producer_stats, puts, count);
+#if defined(Q2_STATS)
+        if(q2_used(ctx) > ctx->producer_stats.high_watermark)
+        {
+            ctx->producer_stats.high_watermark = q2_used(ctx);
+        }
+#endif
+    }
+}
+
+/**********************************************************
+ * Name:
+ *    q2_advance_tail
+ *
+ * Description:
+ *    Moves the tail index forward over count items that
+ *    have been read. Caller must ensure count items are
+ *    queued.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items read.
+ *********************************************************/
+static void q2_advance_tail(q2_context_t* const ctx, uint32_t count)
+{
+    if(count > 0)
+    {
+        Q2_SOJOURN_RECORD(ctx, ctx->tail, count);
+        ctx->tail += count;
+
+        Q2_STATS_ADD(ctx, consumer_stats, gets, count);
+    }
+}
+
 /**********************************************************
  * Procedures
  *********************************************************/
@@ -61,27 +136,130 @@ uint32_t q2_init(q2_context_t* const ctx)
 
 /**********************************************************
  * Name:
- *    q2_put
+ *    q2_put_overwrite
  *
  * Description:
  *    Adds an item to the queue and updates the head index.
+ *    If the queue is full the oldest item is dropped to
+ *    make room, so the producer never stalls.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
  *    void* const input - Item to be put in the queue.
+ *    uint32_t* const overwritten - Number of items dropped,
+ *                                  zero or one.
  *
  * Returns:
- *    Q2_ERROR_FULL - Queue is full.
  *    Q2_SUCCESS - Successfully added item to queue.
- *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              overwritten is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_put_overwrite(q2_context_t* const ctx, void* const input, uint32_t* const overwritten)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input || NULL == overwritten)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *overwritten = 0;
+        if(ctx->max_length == q2_used(ctx))
+        {
+            /* Drop the oldest item, its slot is the one head points at */
+            ctx->tail++;
+            *overwritten = 1;
+            Q2_STATS_ADD(ctx, producer_stats, overwrites, 1);
+        }
+
+        memcpy((uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->head) * ctx->item_length), input, ctx->item_length);
+        q2_advance_head(ctx, 1);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_reset
+ *
+ * Description:
+ *    Resets the queue to the initial state.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully reset queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
  *                               called is NULL.
- **********************************************************/
-uint32_t q2_put(q2_context_t* const ctx, void* const input)
+ *********************************************************/
+uint32_t q2_reset(q2_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->head = 0;
+        ctx->tail = 0;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_put_n
+ *
+ * Description:
+ *    Adds up to count items to the queue with at most two
+ *    copies, one up to the end of the buffer and one from
+ *    the start after the wrap. A mirrored buffer takes a
+ *    single copy.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    void* const input - Array of items to be put in the
+ *                        queue.
+ *    uint32_t count - Number of items in input.
+ *    bool all_or_nothing - If set to true, no items are
+ *                          added unless all count fit.
+ *    uint32_t* const transferred - Number of items added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No items could be added, or not all
+ *                    items fit and all_or_nothing is set.
+ *    Q2_SUCCESS - Successfully added transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_put_n(q2_context_t* const ctx, void* const input, uint32_t count, bool all_or_nothing, uint32_t* const transferred)
 {
     q2_return_t ret = Q2_SUCCESS;
+    uint32_t available;
+    uint32_t first;
 
-    if(NULL == ctx || NULL == input)
+    if(NULL == ctx || NULL == input || NULL == transferred)
     {
         ret = Q2_ERROR_NULL_PARAMETER;
     }
@@ -92,22 +270,167 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input)
 
     if(Q2_SUCCESS == ret)
     {
-        /* Check next location */
-        if(((ctx->head + 1) & (ctx->max_length - 1)) == ctx->tail)
+        available = ctx->max_length - q2_used(ctx);
+        if(count > available)
         {
-            ctx->full = true;
+            count = (true == all_or_nothing) ? 0 : available;
+            if(0 == count)
+            {
+                ret = Q2_ERROR_FULL;
+                Q2_STATS_ADD(ctx, producer_stats, full_rejections, 1);
+            }
         }
-        else if(true == ctx->full)
+
+        /* Split the copy at the end of the buffer */
+        first = ctx->max_length - Q2_INDEX(ctx, ctx->head);
+        if(first > count || true == ctx->mirrored)
+        {
+            first = count;
+        }
+        memcpy((uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->head) * ctx->item_length), input, first * ctx->item_length);
+        memcpy(ctx->data, (uint8_t*)input + (first * ctx->item_length), (count - first) * ctx->item_length);
+        q2_advance_head(ctx, count);
+
+        *transferred = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_get_n
+ *
+ * Description:
+ *    Gets up to count items from the queue with at most two
+ *    copies, one up to the end of the buffer and one from
+ *    the start after the wrap. A mirrored buffer takes a
+ *    single copy.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    void* const output - Array to copy the items to.
+ *    uint32_t count - Number of items output can hold.
+ *    bool all_or_nothing - If set to true, no items are
+ *                          retrieved unless count are
+ *                          queued.
+ *    uint32_t* const transferred - Number of items retrieved.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - No items could be retrieved, or fewer
+ *                     than count are queued and
+ *                     all_or_nothing is set.
+ *    Q2_SUCCESS - Successfully retrieved transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_get_n(q2_context_t* const ctx, void* const output, uint32_t count, bool all_or_nothing, uint32_t* const transferred)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t used;
+    uint32_t first;
+
+    if(NULL == ctx || NULL == output || NULL == transferred)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        used = q2_used(ctx);
+        if(count > used)
+        {
+            count = (true == all_or_nothing) ? 0 : used;
+            if(0 == count)
+            {
+                ret = Q2_ERROR_EMPTY;
+                Q2_STATS_ADD(ctx, consumer_stats, empty_polls, 1);
+            }
+        }
+
+        /* Split the copy at the end of the buffer */
+        first = ctx->max_length - Q2_INDEX(ctx, ctx->tail);
+        if(first > count || true == ctx->mirrored)
+        {
+            first = count;
+        }
+        memcpy(output, (uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->tail) * ctx->item_length), first * ctx->item_length);
+        memcpy((uint8_t*)output + (first * ctx->item_length), ctx->data, (count - first) * ctx->item_length);
+        q2_advance_tail(ctx, count);
+
+        *transferred = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_reserve
+ *
+ * Description:
+ *    Returns a pointer to the next free slots so the
+ *    producer can build items in place. The span stops at
+ *    the end of the buffer unless the buffer is mirrored.
+ *    Items become visible to the consumer once q2_commit is
+ *    called.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of slots wanted.
+ *    void** const slot - Set to the first reserved slot.
+ *    uint32_t* const reserved - Number of contiguous slots
+ *                               reserved, at most count.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully reserved slots.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or reserved
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_reserve(q2_context_t* const ctx, uint32_t count, void** const slot, uint32_t* const reserved)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t available;
+
+    if(NULL == ctx || NULL == slot || NULL == reserved)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        available = ctx->max_length - q2_used(ctx);
+        if(0 == available)
         {
             ret = Q2_ERROR_FULL;
+            Q2_STATS_ADD(ctx, producer_stats, full_rejections, 1);
         }
 
-        if(Q2_SUCCESS == ret)
+        /* Stop the span at the end of the buffer, a mirror runs on past it */
+        if(false == ctx->mirrored && available > (ctx->max_length - Q2_INDEX(ctx, ctx->head)))
+        {
+            available = ctx->max_length - Q2_INDEX(ctx, ctx->head);
+        }
+        if(count > available)
         {
-            ctx->empty = false;
-            memcpy((uint8_t*)ctx->data + (ctx->head * ctx->item_length), input, ctx->item_length);
-            ctx->head = ((ctx->head + 1) & (ctx->max_length - 1));
+            count = available;
         }
+
+        *slot = (uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->head) * ctx->item_length);
+        *reserved = count;
     }
 
     return ret;
@@ -115,27 +438,82 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input)
 
 /**********************************************************
  * Name:
- *    q2_get
+ *    q2_commit
  *
  * Description:
- *    Gets an item from the queue and updates the tail index.
+ *    Publishes count items written through q2_reserve and
+ *    updates the head index.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
- *    void* const output - Item to be put in the queue.
+ *    uint32_t count - Number of items written.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Fewer than count slots are free.
+ *    Q2_SUCCESS - Successfully committed items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_commit(q2_context_t* const ctx, uint32_t count)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(count > (ctx->max_length - q2_used(ctx)))
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            q2_advance_head(ctx, count);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_peek
+ *
+ * Description:
+ *    Returns a pointer to the oldest queued items so the
+ *    consumer can process them in place. The span stops at
+ *    the end of the buffer unless the buffer is mirrored.
+ *    Items stay queued until q2_release is called.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items wanted.
+ *    void** const slot - Set to the oldest queued item.
+ *    uint32_t* const available - Number of contiguous items
+ *                                available, at most count.
  *
  * Returns:
  *    Q2_ERROR_EMPTY - Queue is empty.
- *    Q2_SUCCESS - Successfully retrieved item from queue.
- *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_SUCCESS - Successfully peeked items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or available
+ *                              is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_get(q2_context_t * const ctx, void* const output)
+uint32_t q2_peek(q2_context_t* const ctx, uint32_t count, void** const slot, uint32_t* const available)
 {
     q2_return_t ret = Q2_SUCCESS;
+    uint32_t used;
 
-    if(NULL == ctx || NULL == output)
+    if(NULL == ctx || NULL == slot || NULL == available)
     {
         ret = Q2_ERROR_NULL_PARAMETER;
     }
@@ -146,47 +524,185 @@ uint32_t q2_get(q2_context_t * const ctx, void* const output)
 
     if(Q2_SUCCESS == ret)
     {
-        if (ctx->empty)
+        used = q2_used(ctx);
+        if(0 == used)
+        {
+            ret = Q2_ERROR_EMPTY;
+            Q2_STATS_ADD(ctx, consumer_stats, empty_polls, 1);
+        }
+
+        /* Stop the span at the end of the buffer, a mirror runs on past it */
+        if(false == ctx->mirrored && used > (ctx->max_length - Q2_INDEX(ctx, ctx->tail)))
+        {
+            used = ctx->max_length - Q2_INDEX(ctx, ctx->tail);
+        }
+        if(count > used)
+        {
+            count = used;
+        }
+
+        *slot = (uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->tail) * ctx->item_length);
+        *available = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_release
+ *
+ * Description:
+ *    Frees count items processed through q2_peek and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items processed.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Fewer than count items are queued.
+ *    Q2_SUCCESS - Successfully released items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_release(q2_context_t* const ctx, uint32_t count)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(count > q2_used(ctx))
         {
             ret = Q2_ERROR_EMPTY;
         }
         else
         {
-            ctx->full = false;
-            memcpy(output, (uint8_t*)ctx->data + (ctx->tail * ctx->item_length), ctx->item_length);
-            ctx->tail = ((ctx->tail + 1) & (ctx->max_length - 1));
-            if (ctx->head == ctx->tail)
+            q2_advance_tail(ctx, count);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_drain
+ *
+ * Description:
+ *    Calls handler on each queued item in place, oldest
+ *    first, without copying it out. Stops after max_items
+ *    items or max_bytes bytes, or after the handler returns
+ *    false. The tail is advanced once for the whole batch.
+ *    The item pointer is only valid during the call.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_drain(q2_context_t* const ctx, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint8_t* item;
+    uint8_t* end;
+    uint32_t count;
+    uint32_t i = 0;
+    bool more = true;
+
+    if(NULL == ctx || NULL == handler || NULL == drained)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        count = q2_used(ctx);
+        if(0 == count)
+        {
+            ret = Q2_ERROR_EMPTY;
+            Q2_STATS_ADD(ctx, consumer_stats, empty_polls, 1);
+        }
+        if(count > max_items)
+        {
+            count = max_items;
+        }
+        if(Q2_NO_LIMIT != max_bytes && count > (max_bytes / ctx->item_length))
+        {
+            count = max_bytes / ctx->item_length;
+        }
+
+        item = (uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->tail) * ctx->item_length);
+        end = (uint8_t*)ctx->data + (ctx->max_length * ctx->item_length);
+        while(i < count && true == more)
+        {
+            more = handler(item, arg);
+            i++;
+
+            item += ctx->item_length;
+            if(item == end)
             {
-                ctx->empty = true;
+                item = ctx->data;
             }
         }
+        q2_advance_tail(ctx, i);
+
+        *drained = i;
     }
 
     return ret;
 }
 
+#if defined(Q2_STATS)
 /**********************************************************
  * Name:
- *    q2_empty
+ *    q2_stats
  *
  * Description:
- *    Returns whether the queue is empty or not.
+ *    Returns a snapshot of the queue statistics. Only
+ *    available when built with Q2_STATS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
- *    bool* const empty - If set to true, queue is empty.
+ *    q2_stats_t* const stats - Statistics snapshot.
  *
  * Returns:
- *    Q2_SUCCESS - Successfully retrieved empty status.
- *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Successfully retrieved statistics.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or stats is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_empty(q2_context_t* const ctx, bool* const empty)
+uint32_t q2_stats(q2_context_t* const ctx, q2_stats_t* const stats)
 {
     q2_return_t ret = Q2_SUCCESS;
 
-    if(NULL == ctx || NULL == empty)
+    if(NULL == ctx || NULL == stats)
     {
         ret = Q2_ERROR_NULL_PARAMETER;
     }
@@ -197,7 +713,12 @@ uint32_t q2_empty(q2_context_t* const ctx, bool* const empty)
 
     if(Q2_SUCCESS == ret)
     {
-        *empty = ctx->empty;
+        stats->puts = ctx->producer_stats.puts;
+        stats->full_rejections = ctx->producer_stats.full_rejections;
+        stats->overwrites = ctx->producer_stats.overwrites;
+        stats->high_watermark = ctx->producer_stats.high_watermark;
+        stats->gets = ctx->consumer_stats.gets;
+        stats->empty_polls = ctx->consumer_stats.empty_polls;
     }
 
     return ret;
@@ -205,26 +726,27 @@ uint32_t q2_empty(q2_context_t* const ctx, bool* const empty)
 
 /**********************************************************
  * Name:
- *    q2_full
+ *    q2_stats_reset
  *
  * Description:
- *    Returns whether the queue is full or not.
+ *    Clears the queue statistics. The high watermark
+ *    restarts from the current length. Only available when
+ *    built with Q2_STATS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
- *    bool* const full - If set to true, queue is full.
  *
  * Returns:
- *    Q2_SUCCESS - Successfully retrieved full status.
+ *    Q2_SUCCESS - Successfully cleared statistics.
  *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_full(q2_context_t* const ctx, bool* const full)
+uint32_t q2_stats_reset(q2_context_t* const ctx)
 {
     q2_return_t ret = Q2_SUCCESS;
 
-    if(NULL == ctx || NULL == full)
+    if(NULL == ctx)
     {
         ret = Q2_ERROR_NULL_PARAMETER;
     }
@@ -235,34 +757,53 @@ uint32_t q2_full(q2_context_t* const ctx, bool* const full)
 
     if(Q2_SUCCESS == ret)
     {
-        *full = ctx->full;
+        memset(&ctx->producer_stats, 0x00, sizeof(ctx->producer_stats));
+        memset(&ctx->consumer_stats, 0x00, sizeof(ctx->consumer_stats));
+        ctx->producer_stats.high_watermark = q2_used(ctx);
     }
 
     return ret;
 }
+#endif
 
+#if defined(Q2_SOJOURN)
 /**********************************************************
  * Name:
- *    q2_length
+ *    q2_sojourn_percentile
  *
  * Description:
- *    Returns the current length of the queue.
+ *    Returns a percentile of the time items spent queued,
+ *    from put to get, in Q2_SOJOURN_NOW units. The value is
+ *    the top of its histogram bucket, capped at the largest
+ *    delay seen. Safe to call from any thread while the
+ *    queue runs. Only available when built with Q2_SOJOURN
+ *    defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
- *    bool* const length - Current length of queue.
+ *    double percentile - Percentile from 0 to 100.
+ *    uint64_t* const value - Delay at the percentile.
  *
  * Returns:
- *    Q2_SUCCESS - Successfully retrieved length.
- *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_EMPTY - No items have been timed.
+ *    Q2_SUCCESS - Successfully retrieved percentile.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or value is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When percentile is out of
+ *                                 range.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length)
+uint32_t q2_sojourn_percentile(q2_context_t* const ctx, double percentile, uint64_t* const value)
 {
     q2_return_t ret = Q2_SUCCESS;
+    uint64_t total = 0;
+    uint64_t rank;
+    uint64_t seen = 0;
+    uint64_t max;
+    uint32_t bucket = 0;
+    uint32_t exponent;
 
-    if(NULL == ctx || NULL == length)
+    if(NULL == ctx || NULL == value)
     {
         ret = Q2_ERROR_NULL_PARAMETER;
     }
@@ -270,16 +811,54 @@ uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length)
     {
         ret = Q2_ERROR_NOT_INITIALIZED;
     }
+    else if(!(percentile >= 0.0 && percentile <= 100.0))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
 
     if(Q2_SUCCESS == ret)
     {
-        if(true == ctx->full)
+        for(bucket = 0; bucket < Q2_SOJOURN_BUCKETS; bucket++)
         {
-            *length = ctx->max_length;
+            total += atomic_load_explicit(&ctx->sojourn.buckets[bucket], memory_order_relaxed);
         }
-        else
+
+        if(0 == total)
         {
-            *length = (((ctx->head) - (ctx->tail)) & (ctx->max_length - 1));
+            ret = Q2_ERROR_EMPTY;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Smallest bucket holding at least the requested share of the delays */
+        rank = (uint64_t)((percentile / 100.0) * (double)total);
+        if(rank < ((percentile / 100.0) * (double)total) || 0 == rank)
+        {
+            rank++;
+        }
+
+        bucket = 0;
+        seen = atomic_load_explicit(&ctx->sojourn.buckets[0], memory_order_relaxed);
+        while(seen < rank && bucket < (Q2_SOJOURN_BUCKETS - 1))
+        {
+            bucket++;
+            seen += atomic_load_explicit(&ctx->sojourn.buckets[bucket], memory_order_relaxed);
+        }
+
+        /* Top of the bucket, buckets below 2^SUB_BITS hold one value */
+        *value = bucket;
+        if(bucket >= (1U << Q2_SOJOURN_SUB_BITS))
+        {
+            exponent = (bucket >> Q2_SOJOURN_SUB_BITS) + Q2_SOJOURN_SUB_BITS - 1;
+            *value = ((uint64_t)((1U << Q2_SOJOURN_SUB_BITS) + (bucket & ((1U << Q2_SOJOURN_SUB_BITS) - 1))) << (exponent - Q2_SOJOURN_SUB_BITS)) +
+                     ((1ULL << (exponent - Q2_SOJOURN_SUB_BITS)) - 1);
+        }
+
+        max = atomic_load_explicit(&ctx->sojourn.max, memory_order_relaxed);
+        if(*value > max)
+        {
+            *value = max;
         }
     }
 
@@ -288,23 +867,26 @@ uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length)
 
 /**********************************************************
  * Name:
- *    q2_reset
+ *    q2_sojourn_reset
  *
  * Description:
- *    Resets the queue to the initial state.
+ *    Clears the sojourn histogram. Must be called from the
+ *    consumer thread, or while the queue is idle. Only
+ *    available when built with Q2_SOJOURN defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
  *
  * Returns:
- *    Q2_SUCCESS - Successfully reset queue.
+ *    Q2_SUCCESS - Successfully cleared histogram.
  *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_reset(q2_context_t* const ctx)
+uint32_t q2_sojourn_reset(q2_context_t* const ctx)
 {
     q2_return_t ret = Q2_SUCCESS;
+    uint32_t bucket;
 
     if(NULL == ctx)
     {
@@ -317,11 +899,13 @@ uint32_t q2_reset(q2_context_t* const ctx)
 
     if(Q2_SUCCESS == ret)
     {
-        ctx->head = 0;
-        ctx->tail = 0;
-        ctx->full = false;
-        ctx->empty = true;
+        for(bucket = 0; bucket < Q2_SOJOURN_BUCKETS; bucket++)
+        {
+            atomic_store_explicit(&ctx->sojourn.buckets[bucket], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&ctx->sojourn.max, 0, memory_order_relaxed);
     }
 
     return ret;
 }
+#endif
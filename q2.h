@@ -15,6 +15,38 @@
  *********************************************************/
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(Q2_SOJOURN)
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#ifndef Q2_CACHE_LINE_SIZE
+#define Q2_CACHE_LINE_SIZE (64)
+#endif
+
+/* Timeout value for the blocking variants that never expires */
+#define Q2_WAIT_FOREVER (0xFFFFFFFF)
+
+/* Item or byte limit for the drain calls that never stops a batch */
+#define Q2_NO_LIMIT (0xFFFFFFFF)
+
+/* Define Q2_DEBUG_CHECKS to have the inline calls validate their arguments */
+
+#if defined(Q2_SOJOURN)
+/* Sojourn histogram, 2^SUB_BITS linear buckets per power of two */
+#define Q2_SOJOURN_SUB_BITS (4)
+#define Q2_SOJOURN_BUCKETS ((64 - Q2_SOJOURN_SUB_BITS + 1) << Q2_SOJOURN_SUB_BITS)
+
+/* Times one item in every Q2_SOJOURN_SAMPLE, a power of two, to spread the clock cost */
+#ifndef Q2_SOJOURN_SAMPLE
+#define Q2_SOJOURN_SAMPLE (1)
+#endif
+#endif
 
 /**********************************************************
  * Types
@@ -29,6 +61,11 @@ typedef enum
     Q2_ERROR_LENGTH_NOT_POWER_OF_TWO = (Q2_RETURN_BASE + 3),
     Q2_ERROR_NULL_PARAMETER          = (Q2_RETURN_BASE + 4),
     Q2_ERROR_NOT_INITIALIZED         = (Q2_RETURN_BASE + 5),
+    Q2_ERROR_TIMEOUT                 = (Q2_RETURN_BASE + 6),
+    Q2_ERROR_INVALID_PARAMETER       = (Q2_RETURN_BASE + 7),
+    Q2_ERROR_ALLOCATION              = (Q2_RETURN_BASE + 8),
+    Q2_ERROR_INCOMPATIBLE            = (Q2_RETURN_BASE + 9),
+    Q2_ERROR_IO                      = (Q2_RETURN_BASE + 10),
 
     Q2_RETURN_MAX                    = (0xFF)
 } q2_return_t;
@@ -37,30 +74,117 @@ typedef struct
 {
     bool initialized;
 
+    /* Free running, length is head - tail and slots are masked on use */
     uint32_t head;
     uint32_t tail;
-    bool empty;
-    bool full;
 
     void* data;
     uint32_t max_length;
     uint32_t item_length;
+
+    /* Buffer is mapped twice back to back, spans may run past the end */
+    bool mirrored;
+
+#if defined(Q2_SOJOURN)
+    /* Put time of each slot, NULL leaves the context untimed */
+    uint64_t* stamps;
+#endif
+
+#if defined(Q2_STATS)
+    /* Written on put, kept off the consumer's cache line */
+    _Alignas(Q2_CACHE_LINE_SIZE) struct
+    {
+        uint64_t puts;
+        uint64_t full_rejections;
+        uint64_t overwrites;
+        uint32_t high_watermark;
+    } producer_stats;
+
+    /* Written on get, kept off the producer's cache line */
+    _Alignas(Q2_CACHE_LINE_SIZE) struct
+    {
+        uint64_t gets;
+        uint64_t empty_polls;
+    } consumer_stats;
+#endif
+
+#if defined(Q2_SOJOURN)
+    /* Written on get only, readers load it without blocking the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) struct
+    {
+        _Atomic uint64_t buckets[Q2_SOJOURN_BUCKETS];
+        _Atomic uint64_t max;
+    } sojourn;
+#endif
 } q2_context_t;
 
+#if defined(Q2_STATS)
+typedef struct
+{
+    uint64_t puts;
+    uint64_t gets;
+    uint64_t full_rejections;
+    uint64_t empty_polls;
+    uint64_t overwrites;
+    uint32_t high_watermark;
+} q2_stats_t;
+#endif
+
+/* Drain callback, sees the item in place and returns false to stop after it */
+typedef bool (*q2_drain_handler_t)(void* const item, void* const arg);
+
 /**********************************************************
  * Macros
  *********************************************************/
+#if defined(__x86_64__) || defined(__i386__)
+#define Q2_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define Q2_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define Q2_CPU_RELAX()
+#endif
+
+#if defined(Q2_STATS)
+#define Q2_STATS_ADD(ctx, side, counter, value) ((ctx)->side.counter += (value))
+#else
+#define Q2_STATS_ADD(ctx, side, counter, value)
+#endif
+
+#if defined(Q2_SOJOURN)
+/* Timestamp source, TSC ticks with Q2_SOJOURN_TSC or raw monotonic ns */
+#if !defined(Q2_SOJOURN_NOW)
+#if defined(Q2_SOJOURN_TSC) && (defined(__x86_64__) || defined(__i386__))
+#define Q2_SOJOURN_NOW() __builtin_ia32_rdtsc()
+#else
+#define Q2_SOJOURN_NOW() q2_sojourn_now()
+#endif
+#endif
+#define Q2_SOJOURN_STAMP(ctx, index, count) q2_sojourn_stamp((ctx), (index), (count))
+#define Q2_SOJOURN_RECORD(ctx, index, count) q2_sojourn_record((ctx), (index), (count))
+#define Q2_SOJOURN_STORAGE(context_name, queue_size) static uint64_t context_name##_stamps[queue_size];
+#define Q2_SOJOURN_FIELDS(context_name) .stamps = context_name##_stamps,
+#else
+#define Q2_SOJOURN_STAMP(ctx, index, count)
+#define Q2_SOJOURN_RECORD(ctx, index, count)
+#define Q2_SOJOURN_STORAGE(context_name, queue_size)
+#define Q2_SOJOURN_FIELDS(context_name)
+#endif
+
+/* Buffer slot of a free running index */
+#define Q2_INDEX(ctx, index) ((index) & ((ctx)->max_length - 1))
+
 #define Q2(context_name, struct_type, queue_size) \
         static struct_type context_name##_array[queue_size]; \
+        Q2_SOJOURN_STORAGE(context_name, queue_size) \
         static q2_context_t context_name = { \
+            Q2_SOJOURN_FIELDS(context_name) \
             .initialized = false, \
             .head = 0, \
             .tail = 0, \
-            .empty = true, \
-            .full = false, \
             .data = context_name##_array, \
             .max_length = queue_size, \
-            .item_length = sizeof(struct_type) \
+            .item_length = sizeof(struct_type), \
+            .mirrored = false \
         };
 
 
@@ -87,12 +211,155 @@ typedef struct
  *********************************************************/
 uint32_t q2_init(q2_context_t* const ctx);
 
+#if defined(Q2_SOJOURN)
+/**********************************************************
+ * Name:
+ *    q2_sojourn_now
+ *
+ * Description:
+ *    Default timestamp source, CLOCK_MONOTONIC_RAW in
+ *    nanoseconds where the platform has it.
+ *
+ * Returns:
+ *    Current time in nanoseconds.
+ *********************************************************/
+static inline uint64_t q2_sojourn_now(void)
+{
+    struct timespec now;
+
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_sojourn_bucket
+ *
+ * Description:
+ *    Maps a delay to its log-linear histogram bucket. Values
+ *    below 2^Q2_SOJOURN_SUB_BITS get a bucket each, larger
+ *    values keep their top Q2_SOJOURN_SUB_BITS bits after
+ *    the leading one.
+ *
+ * Parameters:
+ *    uint64_t value - Delay to bucket.
+ *
+ * Returns:
+ *    Bucket index, below Q2_SOJOURN_BUCKETS.
+ *********************************************************/
+static inline uint32_t q2_sojourn_bucket(uint64_t value)
+{
+    uint32_t bucket = (uint32_t)value;
+    uint32_t exponent;
+
+    if(value >= (1ULL << Q2_SOJOURN_SUB_BITS))
+    {
+        exponent = 63 - __builtin_clzll(value);
+        bucket = ((exponent - Q2_SOJOURN_SUB_BITS + 1) << Q2_SOJOURN_SUB_BITS) +
+                 (uint32_t)((value >> (exponent - Q2_SOJOURN_SUB_BITS)) & ((1U << Q2_SOJOURN_SUB_BITS) - 1));
+    }
+
+    return bucket;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_sojourn_stamp
+ *
+ * Description:
+ *    Stamps the sampled slots among count from index with
+ *    at most one clock read. Called on the put side before
+ *    the head moves.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t index - Free running index of the first item.
+ *    uint32_t count - Number of items put.
+ *********************************************************/
+static inline void q2_sojourn_stamp(q2_context_t* const ctx, uint32_t index, uint32_t count)
+{
+    bool timed = false;
+    uint64_t now = 0;
+    uint32_t i;
+
+    if(NULL != ctx->stamps)
+    {
+        for(i = 0; i < count; i++)
+        {
+            if(0 == ((index + i) & (Q2_SOJOURN_SAMPLE - 1)))
+            {
+                if(false == timed)
+                {
+                    now = Q2_SOJOURN_NOW();
+                    timed = true;
+                }
+                ctx->stamps[Q2_INDEX(ctx, index + i)] = now;
+            }
+        }
+    }
+}
+
+/**********************************************************
+ * Name:
+ *    q2_sojourn_record
+ *
+ * Description:
+ *    Adds the time the sampled items among count from index
+ *    spent queued to the histogram, with at most one clock
+ *    read. Called on the get side before the tail moves.
+ *    The consumer is the only writer, so relaxed loads and
+ *    stores are enough.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t index - Free running index of the first item.
+ *    uint32_t count - Number of items got.
+ *********************************************************/
+static inline void q2_sojourn_record(q2_context_t* const ctx, uint32_t index, uint32_t count)
+{
+    _Atomic uint64_t* bucket;
+    bool timed = false;
+    uint64_t delay;
+    uint64_t now = 0;
+    uint32_t i;
+
+    if(NULL != ctx->stamps)
+    {
+        for(i = 0; i < count; i++)
+        {
+            if(0 == ((index + i) & (Q2_SOJOURN_SAMPLE - 1)))
+            {
+                if(false == timed)
+                {
+                    now = Q2_SOJOURN_NOW();
+                    timed = true;
+                }
+                delay = now - ctx->stamps[Q2_INDEX(ctx, index + i)];
+                bucket = &ctx->sojourn.buckets[q2_sojourn_bucket(delay)];
+                atomic_store_explicit(bucket, atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+                if(delay > atomic_load_explicit(&ctx->sojourn.max, memory_order_relaxed))
+                {
+                    atomic_store_explicit(&ctx->sojourn.max, delay, memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+#endif
+
 /**********************************************************
  * Name:
  *    q2_put
  *
  * Description:
  *    Adds an item to the queue and updates the head index.
+ *    Argument and init checks are only built with
+ *    Q2_DEBUG_CHECKS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
@@ -103,9 +370,48 @@ uint32_t q2_init(q2_context_t* const ctx);
  *    Q2_SUCCESS - Successfully added item to queue.
  *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  **********************************************************/
-uint32_t q2_put(q2_context_t* const ctx, void* const input);
+static inline uint32_t q2_put(q2_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+#if defined(Q2_DEBUG_CHECKS)
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+#endif
+
+    if(Q2_SUCCESS == ret)
+    {
+        if((ctx->head - ctx->tail) == ctx->max_length)
+        {
+            ret = Q2_ERROR_FULL;
+            Q2_STATS_ADD(ctx, producer_stats, full_rejections, 1);
+        }
+        else
+        {
+            memcpy((uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->head) * ctx->item_length), input, ctx->item_length);
+            Q2_SOJOURN_STAMP(ctx, ctx->head, 1);
+            ctx->head++;
+
+            Q2_STATS_ADD(ctx, producer_stats, puts, 1);
+#if defined(Q2_STATS)
+            if((ctx->head - ctx->tail) > ctx->producer_stats.high_watermark)
+            {
+                ctx->producer_stats.high_watermark = ctx->head - ctx->tail;
+            }
+#endif
+        }
+    }
+
+    return ret;
+}
 
 /**********************************************************
  * Name:
@@ -113,6 +419,8 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input);
  *
  * Description:
  *    Gets an item from the queue and updates the tail index.
+ *    Argument and init checks are only built with
+ *    Q2_DEBUG_CHECKS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
@@ -123,9 +431,65 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input);
  *    Q2_SUCCESS - Successfully retrieved item from queue.
  *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
+ *********************************************************/
+static inline uint32_t q2_get(q2_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+#if defined(Q2_DEBUG_CHECKS)
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+#endif
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(ctx->head == ctx->tail)
+        {
+            ret = Q2_ERROR_EMPTY;
+            Q2_STATS_ADD(ctx, consumer_stats, empty_polls, 1);
+        }
+        else
+        {
+            memcpy(output, (uint8_t*)ctx->data + (Q2_INDEX(ctx, ctx->tail) * ctx->item_length), ctx->item_length);
+            Q2_SOJOURN_RECORD(ctx, ctx->tail, 1);
+            ctx->tail++;
+            Q2_STATS_ADD(ctx, consumer_stats, gets, 1);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_put_overwrite
+ *
+ * Description:
+ *    Adds an item to the queue and updates the head index.
+ *    If the queue is full the oldest item is dropped to
+ *    make room, so the producer never stalls.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    void* const input - Item to be put in the queue.
+ *    uint32_t* const overwritten - Number of items dropped,
+ *                                  zero or one.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              overwritten is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
  *********************************************************/
- uint32_t q2_get(q2_context_t* const ctx, void* const output);
+uint32_t q2_put_overwrite(q2_context_t* const ctx, void* const input, uint32_t* const overwritten);
 
 /**********************************************************
  * Name:
@@ -133,6 +497,8 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input);
  *
  * Description:
  *    Returns whether the queue is empty or not.
+ *    Argument and init checks are only built with
+ *    Q2_DEBUG_CHECKS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
@@ -142,9 +508,30 @@ uint32_t q2_put(q2_context_t* const ctx, void* const input);
  *    Q2_SUCCESS - Successfully retrieved empty status.
  *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_empty(q2_context_t* const ctx, bool* const empty);
+static inline uint32_t q2_empty(q2_context_t* const ctx, bool* const empty)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+#if defined(Q2_DEBUG_CHECKS)
+    if(NULL == ctx || NULL == empty)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+#endif
+
+    if(Q2_SUCCESS == ret)
+    {
+        *empty = (ctx->head == ctx->tail);
+    }
+
+    return ret;
+}
 
 /**********************************************************
  * Name:
@@ -152,6 +539,8 @@ uint32_t q2_empty(q2_context_t* const ctx, bool* const empty);
  *
  * Description:
  *    Returns whether the queue is full or not.
+ *    Argument and init checks are only built with
+ *    Q2_DEBUG_CHECKS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
@@ -161,9 +550,30 @@ uint32_t q2_empty(q2_context_t* const ctx, bool* const empty);
  *    Q2_SUCCESS - Successfully retrieved full status.
  *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_full(q2_context_t* const ctx, bool* const full);
+static inline uint32_t q2_full(q2_context_t* const ctx, bool* const full)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+#if defined(Q2_DEBUG_CHECKS)
+    if(NULL == ctx || NULL == full)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+#endif
+
+    if(Q2_SUCCESS == ret)
+    {
+        *full = ((ctx->head - ctx->tail) == ctx->max_length);
+    }
+
+    return ret;
+}
 
 /**********************************************************
  * Name:
@@ -171,6 +581,8 @@ uint32_t q2_full(q2_context_t* const ctx, bool* const full);
  *
  * Description:
  *    Returns the current length of the queue.
+ *    Argument and init checks are only built with
+ *    Q2_DEBUG_CHECKS defined.
  *
  * Parameters:
  *    q2_context_t* const ctx - Pointer to the q2 context.
@@ -180,9 +592,30 @@ uint32_t q2_full(q2_context_t* const ctx, bool* const full);
  *    Q2_SUCCESS - Successfully retrieved length.
  *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
  *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
- *                               called is NULL.
+ *                               called.
  *********************************************************/
-uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length);
+static inline uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+#if defined(Q2_DEBUG_CHECKS)
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+#endif
+
+    if(Q2_SUCCESS == ret)
+    {
+        *length = ctx->head - ctx->tail;
+    }
+
+    return ret;
+}
 
 /**********************************************************
  * Name:
@@ -202,4 +635,284 @@ uint32_t q2_length(q2_context_t* const ctx, uint32_t* const length);
  *********************************************************/
 uint32_t q2_reset(q2_context_t* const ctx);
 
+/**********************************************************
+ * Name:
+ *    q2_put_n
+ *
+ * Description:
+ *    Adds up to count items to the queue with at most two
+ *    copies, one up to the end of the buffer and one from
+ *    the start after the wrap. A mirrored buffer takes a
+ *    single copy.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    void* const input - Array of items to be put in the
+ *                        queue.
+ *    uint32_t count - Number of items in input.
+ *    bool all_or_nothing - If set to true, no items are
+ *                          added unless all count fit.
+ *    uint32_t* const transferred - Number of items added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No items could be added, or not all
+ *                    items fit and all_or_nothing is set.
+ *    Q2_SUCCESS - Successfully added transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_put_n(q2_context_t* const ctx, void* const input, uint32_t count, bool all_or_nothing, uint32_t* const transferred);
+
+/**********************************************************
+ * Name:
+ *    q2_get_n
+ *
+ * Description:
+ *    Gets up to count items from the queue with at most two
+ *    copies, one up to the end of the buffer and one from
+ *    the start after the wrap. A mirrored buffer takes a
+ *    single copy.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    void* const output - Array to copy the items to.
+ *    uint32_t count - Number of items output can hold.
+ *    bool all_or_nothing - If set to true, no items are
+ *                          retrieved unless count are
+ *                          queued.
+ *    uint32_t* const transferred - Number of items retrieved.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - No items could be retrieved, or fewer
+ *                     than count are queued and
+ *                     all_or_nothing is set.
+ *    Q2_SUCCESS - Successfully retrieved transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_get_n(q2_context_t* const ctx, void* const output, uint32_t count, bool all_or_nothing, uint32_t* const transferred);
+
+/**********************************************************
+ * Name:
+ *    q2_reserve
+ *
+ * Description:
+ *    Returns a pointer to the next free slots so the
+ *    producer can build items in place. The span stops at
+ *    the end of the buffer unless the buffer is mirrored.
+ *    Items become visible to the consumer once q2_commit is
+ *    called.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of slots wanted.
+ *    void** const slot - Set to the first reserved slot.
+ *    uint32_t* const reserved - Number of contiguous slots
+ *                               reserved, at most count.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully reserved slots.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or reserved
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_reserve(q2_context_t* const ctx, uint32_t count, void** const slot, uint32_t* const reserved);
+
+/**********************************************************
+ * Name:
+ *    q2_commit
+ *
+ * Description:
+ *    Publishes count items written through q2_reserve and
+ *    updates the head index.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items written.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Fewer than count slots are free.
+ *    Q2_SUCCESS - Successfully committed items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_commit(q2_context_t* const ctx, uint32_t count);
+
+/**********************************************************
+ * Name:
+ *    q2_peek
+ *
+ * Description:
+ *    Returns a pointer to the oldest queued items so the
+ *    consumer can process them in place. The span stops at
+ *    the end of the buffer unless the buffer is mirrored.
+ *    Items stay queued until q2_release is called.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items wanted.
+ *    void** const slot - Set to the oldest queued item.
+ *    uint32_t* const available - Number of contiguous items
+ *                                available, at most count.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully peeked items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or available
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_peek(q2_context_t* const ctx, uint32_t count, void** const slot, uint32_t* const available);
+
+/**********************************************************
+ * Name:
+ *    q2_release
+ *
+ * Description:
+ *    Frees count items processed through q2_peek and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    uint32_t count - Number of items processed.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Fewer than count items are queued.
+ *    Q2_SUCCESS - Successfully released items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_release(q2_context_t* const ctx, uint32_t count);
+
+/**********************************************************
+ * Name:
+ *    q2_drain
+ *
+ * Description:
+ *    Calls handler on each queued item in place, oldest
+ *    first, without copying it out. Stops after max_items
+ *    items or max_bytes bytes, or after the handler returns
+ *    false. The tail is advanced once for the whole batch.
+ *    The item pointer is only valid during the call.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_drain(q2_context_t* const ctx, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained);
+
+#if defined(Q2_STATS)
+/**********************************************************
+ * Name:
+ *    q2_stats
+ *
+ * Description:
+ *    Returns a snapshot of the queue statistics. Only
+ *    available when built with Q2_STATS defined.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    q2_stats_t* const stats - Statistics snapshot.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved statistics.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or stats is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_stats(q2_context_t* const ctx, q2_stats_t* const stats);
+
+/**********************************************************
+ * Name:
+ *    q2_stats_reset
+ *
+ * Description:
+ *    Clears the queue statistics. The high watermark
+ *    restarts from the current length. Only available when
+ *    built with Q2_STATS defined.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully cleared statistics.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_stats_reset(q2_context_t* const ctx);
+#endif
+
+#if defined(Q2_SOJOURN)
+/**********************************************************
+ * Name:
+ *    q2_sojourn_percentile
+ *
+ * Description:
+ *    Returns a percentile of the time items spent queued,
+ *    from put to get, in Q2_SOJOURN_NOW units. The value is
+ *    the top of its histogram bucket, capped at the largest
+ *    delay seen. Safe to call from any thread while the
+ *    queue runs. Only available when built with Q2_SOJOURN
+ *    defined.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *    double percentile - Percentile from 0 to 100.
+ *    uint64_t* const value - Delay at the percentile.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - No items have been timed.
+ *    Q2_SUCCESS - Successfully retrieved percentile.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or value is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When percentile is out of
+ *                                 range.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_sojourn_percentile(q2_context_t* const ctx, double percentile, uint64_t* const value);
+
+/**********************************************************
+ * Name:
+ *    q2_sojourn_reset
+ *
+ * Description:
+ *    Clears the sojourn histogram. Must be called from the
+ *    consumer thread, or while the queue is idle. Only
+ *    available when built with Q2_SOJOURN defined.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Pointer to the q2 context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully cleared histogram.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 init has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_sojourn_reset(q2_context_t* const ctx);
+#endif
+
 #endif // Q2_H
@@ -0,0 +1,380 @@
+/**********************************************************
+ * Name:
+ *     q2_alloc.c
+ *
+ * Description:
+ *     Implementation for runtime creation of power of two
+ *     queues. The context is wrapped with the details of how
+ *     its buffer was allocated so it can be released.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#define _GNU_SOURCE
+#include "q2_alloc.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_ALLOC_ROUND_UP(value, align) ((((value) + (align) - 1) / (align)) * (align))
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Must be first, callers only see this member */
+    q2_context_t ctx;
+
+    /* Start and length of the mapping, NULL when heap allocated */
+    void* mapping;
+    size_t mapping_length;
+} q2_alloc_context_t;
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_alloc_map
+ *
+ * Description:
+ *    Maps an anonymous buffer of at least length bytes,
+ *    applies the page and NUMA options, then faults every
+ *    page in. Huge page buffers are aligned to a huge page
+ *    so the kernel can back them fully. A mirrored buffer
+ *    maps one memfd twice back to back, so the second view
+ *    aliases the first.
+ *
+ * Parameters:
+ *    q2_alloc_context_t* const alloc - Wrapper to fill in.
+ *    size_t length - Buffer size in bytes.
+ *    const q2_alloc_options_t* const options - Options.
+ *
+ * Returns:
+ *    Q2_ERROR_INVALID_PARAMETER - Mirrored buffer is not a
+ *                                 multiple of the page size.
+ *    Q2_ERROR_ALLOCATION - Mapping or binding failed.
+ *    Q2_SUCCESS - Buffer mapped, alloc updated.
+ *********************************************************/
+static q2_return_t q2_alloc_map(q2_alloc_context_t* const alloc, size_t length, const q2_alloc_options_t* const options)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    unsigned long nodemask[Q2_NUMA_NODE_MAX / (8 * sizeof(unsigned long))] = { 0 };
+    size_t granule = (Q2_PAGES_DEFAULT == options->pages) ? (size_t)sysconf(_SC_PAGESIZE) : Q2_HUGE_PAGE_SIZE;
+    size_t views = (true == options->mirrored) ? 2 : 1;
+    size_t align = (Q2_PAGES_DEFAULT == options->pages) ? 0 : Q2_HUGE_PAGE_SIZE;
+    size_t map_length;
+    size_t lead = 0;
+    size_t i;
+    uint8_t* mapping = MAP_FAILED;
+    uint8_t* start = NULL;
+    int fd;
+
+    if(true == options->mirrored && 0 != (length % granule))
+    {
+        /* The second view must start exactly where the ring wraps */
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+    else
+    {
+        length = Q2_ALLOC_ROUND_UP(length, granule);
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(Q2_PAGES_HUGE_EXPLICIT == options->pages && false == options->mirrored)
+        {
+            /* Huge TLB mappings come back huge page aligned */
+            align = 0;
+            mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        else
+        {
+            /* Over map so an aligned start can be trimmed out, the mirror only reserves */
+            mapping = mmap(NULL, (views * length) + align, (1 == views) ? (PROT_READ | PROT_WRITE) : PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+
+        if(MAP_FAILED == mapping)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        map_length = (views * length) + align;
+        if(0 != align)
+        {
+            lead = (align - ((uintptr_t)mapping % align)) % align;
+            if(0 != lead)
+            {
+                munmap(mapping, lead);
+            }
+            if(map_length - lead > views * length)
+            {
+                munmap(mapping + lead + (views * length), map_length - lead - (views * length));
+            }
+        }
+        start = mapping + lead;
+
+        if(true == options->mirrored)
+        {
+            fd = memfd_create("q2", MFD_CLOEXEC | ((Q2_PAGES_HUGE_EXPLICIT == options->pages) ? MFD_HUGETLB : 0));
+            if(-1 == fd ||
+               0 != ftruncate(fd, (off_t)length) ||
+               MAP_FAILED == mmap(start, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) ||
+               MAP_FAILED == mmap(start + length, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0))
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+
+            /* The mappings keep the memfd alive */
+            if(-1 != fd)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(Q2_PAGES_HUGE_TRANSPARENT == options->pages)
+        {
+            /* Advisory only, a kernel without THP still gets a working buffer */
+            (void)madvise(start, views * length, MADV_HUGEPAGE);
+        }
+
+        if(Q2_NUMA_NODE_ANY != options->numa_node)
+        {
+            nodemask[options->numa_node / (8 * sizeof(unsigned long))] = 1ul << (options->numa_node % (8 * sizeof(unsigned long)));
+
+            /* The kernel ignores the last bit of maxnode, hence the plus one */
+            if(0 != syscall(SYS_mbind, start, length, MPOL_BIND, nodemask, (unsigned long)Q2_NUMA_NODE_MAX + 1ul, 0))
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* First touch places the pages on the bound node */
+        memset(start, 0x00, length);
+        for(i = length; i < views * length; i += granule)
+        {
+            (void)*(volatile uint8_t*)(start + i);
+        }
+
+        alloc->mapping = start;
+        alloc->mapping_length = views * length;
+        alloc->ctx.data = start;
+        alloc->ctx.mirrored = options->mirrored;
+    }
+    else if(NULL != start)
+    {
+        munmap(start, views * length);
+    }
+
+    return ret;
+}
+#endif
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_create
+ *
+ * Description:
+ *    Allocates and initializes a q2 context and its buffer.
+ *    The buffer is cache line aligned. Huge page and NUMA
+ *    options map the buffer directly and fault it in up
+ *    front, so no page faults are taken on the hot path.
+ *    Explicit huge pages must be reserved by the system.
+ *    A mirrored buffer is mapped twice back to back so any
+ *    run of up to max_length items is contiguous, its size
+ *    must be a multiple of the page size in use.
+ *
+ * Parameters:
+ *    q2_context_t** const ctx - Set to the new context.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *    const q2_alloc_options_t* const options - Storage
+ *                                              options, or
+ *                                              NULL for
+ *                                              defaults.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 the buffer is over
+ *                                 UINT32_MAX bytes,
+ *                                 a mirrored buffer is not a
+ *                                 page multiple or an option
+ *                                 is unsupported.
+ *    Q2_ERROR_ALLOCATION - Memory could not be allocated or
+ *                          bound to the NUMA node.
+ *    Q2_SUCCESS - Context created and initialized.
+ *********************************************************/
+uint32_t q2_create(q2_context_t** const ctx, uint32_t item_length, uint32_t max_length, const q2_alloc_options_t* const options)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_alloc_options_t defaults = { .pages = Q2_PAGES_DEFAULT, .numa_node = Q2_NUMA_NODE_ANY, .mirrored = false };
+    const q2_alloc_options_t* opts = (NULL == options) ? &defaults : options;
+    q2_alloc_context_t* alloc = NULL;
+    size_t length = 0;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+        *ctx = NULL;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(!((max_length & (max_length - 1)) == 0) || !max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else if(0 == item_length || (uint64_t)item_length * max_length > UINT32_MAX)
+        {
+            /* The queue computes slot offsets in 32 bits */
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+        else if(opts->pages > Q2_PAGES_HUGE_EXPLICIT ||
+                opts->numa_node < Q2_NUMA_NODE_ANY || opts->numa_node >= Q2_NUMA_NODE_MAX)
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+#if !defined(__linux__)
+        else if(Q2_PAGES_DEFAULT != opts->pages || Q2_NUMA_NODE_ANY != opts->numa_node || true == opts->mirrored)
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+#endif
+        else
+        {
+            length = (size_t)item_length * max_length;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        alloc = aligned_alloc(Q2_CACHE_LINE_SIZE, Q2_ALLOC_ROUND_UP(sizeof(q2_alloc_context_t), Q2_CACHE_LINE_SIZE));
+        if(NULL == alloc)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            memset(alloc, 0x00, sizeof(q2_alloc_context_t));
+            alloc->ctx.max_length = max_length;
+            alloc->ctx.item_length = item_length;
+#if defined(Q2_SOJOURN)
+            alloc->ctx.stamps = calloc(max_length, sizeof(uint64_t));
+            if(NULL == alloc->ctx.stamps)
+            {
+                free(alloc);
+                ret = Q2_ERROR_ALLOCATION;
+            }
+#endif
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(Q2_PAGES_DEFAULT == opts->pages && Q2_NUMA_NODE_ANY == opts->numa_node && false == opts->mirrored)
+        {
+            alloc->ctx.data = aligned_alloc(Q2_CACHE_LINE_SIZE, Q2_ALLOC_ROUND_UP(length, Q2_CACHE_LINE_SIZE));
+            if(NULL == alloc->ctx.data)
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+        }
+#if defined(__linux__)
+        else
+        {
+            ret = q2_alloc_map(alloc, length, opts);
+        }
+#endif
+
+        if(Q2_SUCCESS == ret)
+        {
+            ret = q2_init(&alloc->ctx);
+            *ctx = &alloc->ctx;
+        }
+        else
+        {
+#if defined(Q2_SOJOURN)
+            free(alloc->ctx.stamps);
+#endif
+            free(alloc);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_destroy
+ *
+ * Description:
+ *    Frees a context and buffer made by q2 create.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Context from q2 create.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Context freed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *********************************************************/
+uint32_t q2_destroy(q2_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_alloc_context_t* alloc = (q2_alloc_context_t*)ctx;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+#if defined(__linux__)
+        if(NULL != alloc->mapping)
+        {
+            munmap(alloc->mapping, alloc->mapping_length);
+        }
+        else
+#endif
+        {
+            free(alloc->ctx.data);
+        }
+#if defined(Q2_SOJOURN)
+        free(alloc->ctx.stamps);
+#endif
+        free(alloc);
+    }
+
+    return ret;
+}
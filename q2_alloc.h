@@ -0,0 +1,110 @@
+/**********************************************************
+ * Name:
+ *     q2_alloc.h
+ *
+ * Description:
+ *     Header for runtime creation of power of two queues.
+ *     Buffers are cache line aligned and may be backed by
+ *     huge pages, bound to a NUMA node and mirrored.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_ALLOC_H
+#define Q2_ALLOC_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#ifndef Q2_HUGE_PAGE_SIZE
+#define Q2_HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+#endif
+
+/* Highest NUMA node number plus one that can be bound to */
+#ifndef Q2_NUMA_NODE_MAX
+#define Q2_NUMA_NODE_MAX (1024)
+#endif
+
+/* Node value that leaves placement to the kernel */
+#define Q2_NUMA_NODE_ANY (-1)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef enum
+{
+    Q2_PAGES_DEFAULT = 0,
+    Q2_PAGES_HUGE_TRANSPARENT,
+    Q2_PAGES_HUGE_EXPLICIT
+} q2_pages_t;
+
+typedef struct
+{
+    q2_pages_t pages;
+    int32_t numa_node;
+    bool mirrored;
+} q2_alloc_options_t;
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_create
+ *
+ * Description:
+ *    Allocates and initializes a q2 context and its buffer.
+ *    The buffer is cache line aligned. Huge page and NUMA
+ *    options map the buffer directly and fault it in up
+ *    front, so no page faults are taken on the hot path.
+ *    Explicit huge pages must be reserved by the system.
+ *    A mirrored buffer is mapped twice back to back so any
+ *    run of up to max_length items is contiguous, its size
+ *    must be a multiple of the page size in use.
+ *
+ * Parameters:
+ *    q2_context_t** const ctx - Set to the new context.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *    const q2_alloc_options_t* const options - Storage
+ *                                              options, or
+ *                                              NULL for
+ *                                              defaults.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 the buffer is over
+ *                                 UINT32_MAX bytes,
+ *                                 a mirrored buffer is not a
+ *                                 page multiple or an option
+ *                                 is unsupported.
+ *    Q2_ERROR_ALLOCATION - Memory could not be allocated or
+ *                          bound to the NUMA node.
+ *    Q2_SUCCESS - Context created and initialized.
+ *********************************************************/
+uint32_t q2_create(q2_context_t** const ctx, uint32_t item_length, uint32_t max_length, const q2_alloc_options_t* const options);
+
+/**********************************************************
+ * Name:
+ *    q2_destroy
+ *
+ * Description:
+ *    Frees a context and buffer made by q2 create.
+ *
+ * Parameters:
+ *    q2_context_t* const ctx - Context from q2 create.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Context freed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *********************************************************/
+uint32_t q2_destroy(q2_context_t* const ctx);
+
+#endif // Q2_ALLOC_H
@@ -0,0 +1,527 @@
+/**********************************************************
+ * Name:
+ *     q2_bcast.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer broadcast
+ *     queue. Head and cursors are free running, the slot
+ *     index is taken by masking. The producer keeps the
+ *     slowest cursor it last saw and only scans the
+ *     consumers again when that says the queue is full.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_bcast.h"
+#include <string.h>
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_bcast_slowest
+ *
+ * Description:
+ *    Returns the cursor furthest behind head. Pairs with
+ *    the fence in q2_bcast_add, so a consumer added after
+ *    the scan starts at or past head.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t head - Producer's current head.
+ *
+ * Returns:
+ *    Slowest cursor, or head when there are no consumers.
+ *********************************************************/
+static uint32_t q2_bcast_slowest(q2_bcast_context_t* const ctx, uint32_t head)
+{
+    uint32_t slowest = head;
+    uint32_t cursor;
+    uint32_t count;
+    uint32_t i;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    count = atomic_load_explicit(&ctx->consumer_count, memory_order_acquire);
+    for(i = 0; i < count; i++)
+    {
+        cursor = atomic_load_explicit(&ctx->consumers[i].cursor, memory_order_acquire);
+        if((head - cursor) > (head - slowest))
+        {
+            slowest = cursor;
+        }
+    }
+
+    return slowest;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_check
+ *
+ * Description:
+ *    Checks the parameters shared by the consumer calls.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    const void* const pointer - Output parameter, NULL is
+ *                                an error.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or pointer is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_SUCCESS - Parameters valid.
+ *********************************************************/
+static q2_return_t q2_bcast_check(q2_bcast_context_t* const ctx, uint32_t consumer, const void* const pointer)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == pointer)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(consumer >= atomic_load_explicit(&ctx->consumer_count, memory_order_acquire))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_bcast_init
+ *
+ * Description:
+ *    Initializes the context with no consumers. Checks that
+ *    the queue length is a power of two. Must be called
+ *    before the producer and consumer threads are started.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there is no room for
+ *                                 any consumer.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_bcast_init(q2_bcast_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+    {
+        ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+    }
+    else if(0 == ctx->max_consumers)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+    else
+    {
+        atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ctx->consumer_count, 0, memory_order_relaxed);
+        ctx->cursor_cache = 0;
+        ctx->initialized = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_add
+ *
+ * Description:
+ *    Registers a consumer. It sees every item published
+ *    from now on. The producer may already be running, but
+ *    consumers must be added from one thread at a time.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const consumer - Set to the consumer's index.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Every consumer slot is taken.
+ *    Q2_SUCCESS - Consumer registered.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or consumer is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_add(q2_bcast_context_t* const ctx, uint32_t* const consumer)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_bcast_consumer_t* added;
+    uint32_t count;
+    uint32_t head;
+
+    if(NULL == ctx || NULL == consumer)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        count = atomic_load_explicit(&ctx->consumer_count, memory_order_relaxed);
+        if(count == ctx->max_consumers)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            added = &ctx->consumers[count];
+            head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+            atomic_store_explicit(&added->cursor, head, memory_order_relaxed);
+            atomic_store_explicit(&ctx->consumer_count, count + 1, memory_order_seq_cst);
+
+            /* Items published before the producer could see this cursor may already be overwritten */
+            head = atomic_load_explicit(&ctx->head, memory_order_seq_cst);
+            atomic_store_explicit(&added->cursor, head, memory_order_release);
+            added->head_cache = head;
+
+            *consumer = count;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index
+ *    to every consumer. The consumer cursors are only read
+ *    when the cached slowest cursor says full. Must only be
+ *    called from the producer thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - The slowest consumer is a full queue
+ *                    behind.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_put(q2_bcast_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        if((head - ctx->cursor_cache) >= ctx->max_length)
+        {
+            ctx->cursor_cache = q2_bcast_slowest(ctx, head);
+        }
+
+        if((head - ctx->cursor_cache) >= ctx->max_length)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            memcpy((uint8_t*)ctx->data + (Q2_INDEX(ctx, head) * ctx->item_length), input, ctx->item_length);
+            atomic_store_explicit(&ctx->head, head + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_put_n
+ *
+ * Description:
+ *    Adds up to count items to the queue and publishes them
+ *    with a single head update. Must only be called from
+ *    the producer thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    void* const input - Array of items to be put in the
+ *                        queue.
+ *    uint32_t count - Number of items in input.
+ *    uint32_t* const transferred - Number of items added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No items could be added.
+ *    Q2_SUCCESS - Successfully added transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_put_n(q2_bcast_context_t* const ctx, void* const input, uint32_t count, uint32_t* const transferred)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+    uint32_t available;
+    uint32_t first;
+
+    if(NULL == ctx || NULL == input || NULL == transferred)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        available = ctx->max_length - (head - ctx->cursor_cache);
+        if(count > available)
+        {
+            ctx->cursor_cache = q2_bcast_slowest(ctx, head);
+            available = ctx->max_length - (head - ctx->cursor_cache);
+        }
+        if(count > available)
+        {
+            count = available;
+            if(0 == count)
+            {
+                ret = Q2_ERROR_FULL;
+            }
+        }
+
+        /* Split the copy at the end of the buffer */
+        first = ctx->max_length - Q2_INDEX(ctx, head);
+        if(first > count)
+        {
+            first = count;
+        }
+        memcpy((uint8_t*)ctx->data + (Q2_INDEX(ctx, head) * ctx->item_length), input, first * ctx->item_length);
+        memcpy(ctx->data, (uint8_t*)input + (first * ctx->item_length), (count - first) * ctx->item_length);
+        if(0 != count)
+        {
+            atomic_store_explicit(&ctx->head, head + count, memory_order_release);
+        }
+
+        *transferred = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_get
+ *
+ * Description:
+ *    Copies the consumer's next item out and advances its
+ *    cursor. Must only be called from that consumer's
+ *    thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Consumer has read every published
+ *                     item.
+ *    Q2_SUCCESS - Successfully retrieved item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_get(q2_bcast_context_t* const ctx, uint32_t consumer, void* const output)
+{
+    q2_return_t ret = q2_bcast_check(ctx, consumer, output);
+    q2_bcast_consumer_t* reader;
+    uint32_t cursor;
+
+    if(Q2_SUCCESS == ret)
+    {
+        reader = &ctx->consumers[consumer];
+        cursor = atomic_load_explicit(&reader->cursor, memory_order_relaxed);
+
+        /* Only touch the producer's cache line when the cached head says empty */
+        if(cursor == reader->head_cache)
+        {
+            reader->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        }
+
+        if(cursor == reader->head_cache)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        else
+        {
+            memcpy(output, (uint8_t*)ctx->data + (Q2_INDEX(ctx, cursor) * ctx->item_length), ctx->item_length);
+            atomic_store_explicit(&reader->cursor, cursor + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_drain
+ *
+ * Description:
+ *    Calls handler in place on each item the consumer has
+ *    not read, up to the published head. Stops after
+ *    max_items items or max_bytes bytes, or after the
+ *    handler returns false. The head is loaded and the
+ *    cursor is published once for the whole batch. The item
+ *    pointer is only valid during the call. Must only be
+ *    called from that consumer's thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Consumer has read every published
+ *                     item.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_drain(q2_bcast_context_t* const ctx, uint32_t consumer, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_bcast_consumer_t* reader;
+    uint32_t cursor;
+    uint32_t count;
+    uint32_t i = 0;
+    bool more = true;
+
+    if(NULL == handler)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+        ret = q2_bcast_check(ctx, consumer, drained);
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        reader = &ctx->consumers[consumer];
+        cursor = atomic_load_explicit(&reader->cursor, memory_order_relaxed);
+        reader->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        count = reader->head_cache - cursor;
+        if(0 == count)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        if(count > max_items)
+        {
+            count = max_items;
+        }
+        if(Q2_NO_LIMIT != max_bytes && count > (max_bytes / ctx->item_length))
+        {
+            count = max_bytes / ctx->item_length;
+        }
+
+        while(i < count && true == more)
+        {
+            more = handler((uint8_t*)ctx->data + (Q2_INDEX(ctx, cursor + i) * ctx->item_length), arg);
+            i++;
+        }
+
+        /* One release for the batch, the producer sees every slot freed at once */
+        if(0 != i)
+        {
+            atomic_store_explicit(&reader->cursor, cursor + i, memory_order_release);
+        }
+
+        *drained = i;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_length
+ *
+ * Description:
+ *    Returns the number of published items the consumer
+ *    has not read yet. The value is a snapshot and may be
+ *    stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    uint32_t* const length - Items left for the consumer.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_length(q2_bcast_context_t* const ctx, uint32_t consumer, uint32_t* const length)
+{
+    q2_return_t ret = q2_bcast_check(ctx, consumer, length);
+    uint32_t cursor;
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Cursor first, so the length never goes negative */
+        cursor = atomic_load_explicit(&ctx->consumers[consumer].cursor, memory_order_acquire);
+        *length = atomic_load_explicit(&ctx->head, memory_order_acquire) - cursor;
+    }
+
+    return ret;
+}
@@ -0,0 +1,252 @@
+/**********************************************************
+ * Name:
+ *     q2_bcast.h
+ *
+ * Description:
+ *     Header for lock-free single producer broadcast queue.
+ *     Every registered consumer sees every item through its
+ *     own cursor over one shared buffer. The producer is
+ *     held back by the slowest cursor.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_BCAST_H
+#define Q2_BCAST_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+/* One per consumer, each on its own cache line */
+typedef struct
+{
+    /* Consumer owned, next sequence to read, published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t cursor;
+    uint32_t head_cache;
+} q2_bcast_consumer_t;
+
+typedef struct
+{
+    /* Producer owned, head is published to the consumers */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+    uint32_t cursor_cache;
+
+    /* Grows as consumers are added */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t consumer_count;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    q2_bcast_consumer_t* consumers;
+    uint32_t max_consumers;
+    void* data;
+    uint32_t max_length;
+    uint32_t item_length;
+} q2_bcast_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_BCAST(context_name, struct_type, queue_size, consumers_size) \
+        static struct_type context_name##_array[queue_size]; \
+        static q2_bcast_consumer_t context_name##_consumers[(consumers_size) > 0 ? (consumers_size) : 1]; \
+        static q2_bcast_context_t context_name = { \
+            .head = 0, \
+            .cursor_cache = 0, \
+            .consumer_count = 0, \
+            .initialized = false, \
+            .consumers = context_name##_consumers, \
+            .max_consumers = consumers_size, \
+            .data = context_name##_array, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_bcast_init
+ *
+ * Description:
+ *    Initializes the context with no consumers. Checks that
+ *    the queue length is a power of two. Must be called
+ *    before the producer and consumer threads are started.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there is no room for
+ *                                 any consumer.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_bcast_init(q2_bcast_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_add
+ *
+ * Description:
+ *    Registers a consumer. It sees every item published
+ *    from now on. The producer may already be running, but
+ *    consumers must be added from one thread at a time.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const consumer - Set to the consumer's index.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Every consumer slot is taken.
+ *    Q2_SUCCESS - Consumer registered.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or consumer is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_add(q2_bcast_context_t* const ctx, uint32_t* const consumer);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index
+ *    to every consumer. The consumer cursors are only read
+ *    when the cached slowest cursor says full. Must only be
+ *    called from the producer thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - The slowest consumer is a full queue
+ *                    behind.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_put(q2_bcast_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_put_n
+ *
+ * Description:
+ *    Adds up to count items to the queue and publishes them
+ *    with a single head update. Must only be called from
+ *    the producer thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    void* const input - Array of items to be put in the
+ *                        queue.
+ *    uint32_t count - Number of items in input.
+ *    uint32_t* const transferred - Number of items added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No items could be added.
+ *    Q2_SUCCESS - Successfully added transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_put_n(q2_bcast_context_t* const ctx, void* const input, uint32_t count, uint32_t* const transferred);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_get
+ *
+ * Description:
+ *    Copies the consumer's next item out and advances its
+ *    cursor. Must only be called from that consumer's
+ *    thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Consumer has read every published
+ *                     item.
+ *    Q2_SUCCESS - Successfully retrieved item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_get(q2_bcast_context_t* const ctx, uint32_t consumer, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_drain
+ *
+ * Description:
+ *    Calls handler in place on each item the consumer has
+ *    not read, up to the published head. Stops after
+ *    max_items items or max_bytes bytes, or after the
+ *    handler returns false. The head is loaded and the
+ *    cursor is published once for the whole batch. The item
+ *    pointer is only valid during the call. Must only be
+ *    called from that consumer's thread.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Consumer has read every published
+ *                     item.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_drain(q2_bcast_context_t* const ctx, uint32_t consumer, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained);
+
+/**********************************************************
+ * Name:
+ *    q2_bcast_length
+ *
+ * Description:
+ *    Returns the number of published items the consumer
+ *    has not read yet. The value is a snapshot and may be
+ *    stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_bcast_context_t* const ctx - Pointer to the context.
+ *    uint32_t consumer - Index from q2 bcast add.
+ *    uint32_t* const length - Items left for the consumer.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When consumer is not
+ *                                 registered.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 bcast init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_bcast_length(q2_bcast_context_t* const ctx, uint32_t consumer, uint32_t* const length);
+
+#endif // Q2_BCAST_H
@@ -0,0 +1,293 @@
+/**********************************************************
+ * Name:
+ *     q2_deque.c
+ *
+ * Description:
+ *     Implementation for lock-free work stealing deque over a
+ *     power of two buffer, after Chase and Lev with the C11
+ *     orderings of Le et al. Top and bottom are free running,
+ *     the slot index is taken by masking. Thieves copy the
+ *     item before claiming it, a failed claim discards the
+ *     copy.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_deque.h"
+#include <string.h>
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_deque_init
+ *
+ * Description:
+ *    Initializes the deque context. Checks that the deque
+ *    length is a power of two. Must be called before the
+ *    owner and thief threads are started.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_deque_init(q2_deque_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Check for power of two */
+        if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else
+        {
+            atomic_store_explicit(&ctx->top, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->bottom, 0, memory_order_relaxed);
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_deque_push
+ *
+ * Description:
+ *    Adds an item at the bottom of the deque. Uses no atomic
+ *    read-modify-write. Must only be called from the owner
+ *    thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be pushed.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Deque is full.
+ *    Q2_SUCCESS - Successfully pushed item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_push(q2_deque_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t bottom;
+    uint32_t top;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        bottom = atomic_load_explicit(&ctx->bottom, memory_order_relaxed);
+        top = atomic_load_explicit(&ctx->top, memory_order_acquire);
+
+        /* A stale top only makes the deque look fuller than it is */
+        if((bottom - top) >= ctx->max_length)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            memcpy((uint8_t*)ctx->data + ((bottom & (ctx->max_length - 1)) * ctx->item_length), input, ctx->item_length);
+            atomic_store_explicit(&ctx->bottom, bottom + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_deque_pop
+ *
+ * Description:
+ *    Removes the most recently pushed item from the bottom
+ *    of the deque. Only races with thieves, using compare
+ *    and swap, when a single item is left. Must only be
+ *    called from the owner thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Deque is empty, or the last item was
+ *                     stolen.
+ *    Q2_SUCCESS - Successfully popped item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_pop(q2_deque_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t bottom;
+    uint32_t top;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Claim the bottom slot first, then see whether a thief got there */
+        bottom = atomic_load_explicit(&ctx->bottom, memory_order_relaxed) - 1;
+        atomic_store_explicit(&ctx->bottom, bottom, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        top = atomic_load_explicit(&ctx->top, memory_order_relaxed);
+
+        if((int32_t)(bottom - top) < 0)
+        {
+            ret = Q2_ERROR_EMPTY;
+            atomic_store_explicit(&ctx->bottom, bottom + 1, memory_order_relaxed);
+        }
+        else
+        {
+            memcpy(output, (uint8_t*)ctx->data + ((bottom & (ctx->max_length - 1)) * ctx->item_length), ctx->item_length);
+
+            /* Last item, race the thieves for it through top */
+            if(bottom == top)
+            {
+                if(false == atomic_compare_exchange_strong_explicit(&ctx->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+                {
+                    ret = Q2_ERROR_EMPTY;
+                }
+                atomic_store_explicit(&ctx->bottom, bottom + 1, memory_order_relaxed);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_deque_steal
+ *
+ * Description:
+ *    Removes the oldest item from the top of the deque.
+ *    Retries when another thief or the owner takes the
+ *    item first. May be called from any thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Deque is empty.
+ *    Q2_SUCCESS - Successfully stole item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_steal(q2_deque_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t bottom;
+    uint32_t top;
+    bool stolen = false;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    while(Q2_SUCCESS == ret && false == stolen)
+    {
+        top = atomic_load_explicit(&ctx->top, memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        bottom = atomic_load_explicit(&ctx->bottom, memory_order_acquire);
+
+        if((int32_t)(bottom - top) <= 0)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        else
+        {
+            /* The slot cannot be reused until top moves, which fails the claim */
+            memcpy(output, (uint8_t*)ctx->data + ((top & (ctx->max_length - 1)) * ctx->item_length), ctx->item_length);
+            stolen = atomic_compare_exchange_strong_explicit(&ctx->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_deque_length
+ *
+ * Description:
+ *    Returns the current length of the deque. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of deque.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_length(q2_deque_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t bottom;
+    uint32_t top;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Top is loaded first so a racing steal cannot make it pass bottom */
+        top = atomic_load_explicit(&ctx->top, memory_order_acquire);
+        bottom = atomic_load_explicit(&ctx->bottom, memory_order_acquire);
+        *length = ((int32_t)(bottom - top) > 0) ? (bottom - top) : 0;
+    }
+
+    return ret;
+}
@@ -0,0 +1,166 @@
+/**********************************************************
+ * Name:
+ *     q2_deque.h
+ *
+ * Description:
+ *     Header for lock-free work stealing deque over a power
+ *     of two buffer (Chase-Lev). The owner thread pushes and
+ *     pops at the bottom, any number of thief threads steal
+ *     from the top. Items are stored by value.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_DEQUE_H
+#define Q2_DEQUE_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Advanced by thieves with compare and swap */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t top;
+
+    /* Owner only writes bottom, thieves read it */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t bottom;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    void* data;
+    uint32_t max_length;
+    uint32_t item_length;
+} q2_deque_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_DEQUE(context_name, struct_type, queue_size) \
+        static struct_type context_name##_array[queue_size]; \
+        static q2_deque_context_t context_name = { \
+            .top = 0, \
+            .bottom = 0, \
+            .initialized = false, \
+            .data = context_name##_array, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_deque_init
+ *
+ * Description:
+ *    Initializes the deque context. Checks that the deque
+ *    length is a power of two. Must be called before the
+ *    owner and thief threads are started.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_deque_init(q2_deque_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_deque_push
+ *
+ * Description:
+ *    Adds an item at the bottom of the deque. Uses no atomic
+ *    read-modify-write. Must only be called from the owner
+ *    thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be pushed.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Deque is full.
+ *    Q2_SUCCESS - Successfully pushed item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_push(q2_deque_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_deque_pop
+ *
+ * Description:
+ *    Removes the most recently pushed item from the bottom
+ *    of the deque. Only races with thieves, using compare
+ *    and swap, when a single item is left. Must only be
+ *    called from the owner thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Deque is empty, or the last item was
+ *                     stolen.
+ *    Q2_SUCCESS - Successfully popped item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_pop(q2_deque_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_deque_steal
+ *
+ * Description:
+ *    Removes the oldest item from the top of the deque.
+ *    Retries when another thief or the owner takes the
+ *    item first. May be called from any thread.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Deque is empty.
+ *    Q2_SUCCESS - Successfully stole item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_steal(q2_deque_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_deque_length
+ *
+ * Description:
+ *    Returns the current length of the deque. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_deque_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of deque.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 deque init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_deque_length(q2_deque_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_DEQUE_H
@@ -0,0 +1,451 @@
+/**********************************************************
+ * Name:
+ *     q2_grow.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer, single
+ *     consumer queue that grows and shrinks at runtime. Each
+ *     segment is an spsc ring with free running indices. A
+ *     segment is closed by linking the next one, after which
+ *     the producer never writes to it again.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_grow.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_GROW_ROUND_UP(value, align) ((((value) + (align) - 1) / (align)) * (align))
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_grow_segment_alloc
+ *
+ * Description:
+ *    Allocates an empty segment of length items.
+ *
+ * Parameters:
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t length - Number of items, power of two.
+ *
+ * Returns:
+ *    The segment, or NULL when it could not be allocated.
+ *********************************************************/
+static q2_grow_segment_t* q2_grow_segment_alloc(uint32_t item_length, uint32_t length)
+{
+    size_t size = sizeof(q2_grow_segment_t) + ((size_t)item_length * length);
+    q2_grow_segment_t* segment = aligned_alloc(Q2_CACHE_LINE_SIZE, Q2_GROW_ROUND_UP(size, Q2_CACHE_LINE_SIZE));
+
+    if(NULL != segment)
+    {
+        atomic_init(&segment->head, 0);
+        atomic_init(&segment->tail, 0);
+        atomic_init(&segment->next, NULL);
+        segment->max_length = length;
+    }
+
+    return segment;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_grow_link
+ *
+ * Description:
+ *    Closes the producer's segment by linking a new one of
+ *    length items after it, and moves the producer there.
+ *    Producer side.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    uint32_t length - Length of the new segment.
+ *
+ * Returns:
+ *    Q2_ERROR_ALLOCATION - The segment could not be
+ *                          allocated, nothing changed.
+ *    Q2_SUCCESS - Producer moved to the new segment.
+ *********************************************************/
+static q2_return_t q2_grow_link(q2_grow_context_t* const ctx, uint32_t length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_grow_segment_t* segment = q2_grow_segment_alloc(ctx->item_length, length);
+
+    if(NULL == segment)
+    {
+        ret = Q2_ERROR_ALLOCATION;
+    }
+    else
+    {
+        /* Release orders every head store to the old segment before the link */
+        atomic_store_explicit(&ctx->producer->next, segment, memory_order_release);
+        ctx->producer = segment;
+        ctx->tail_cache = 0;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_grow_create
+ *
+ * Description:
+ *    Allocates the first segment, min_length items long,
+ *    and initializes the context. Must be called before the
+ *    producer and consumer threads are started.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t min_length - Starting and smallest segment
+ *                          length, power of two.
+ *    const q2_grow_options_t* const options - Growth
+ *                                             options, or
+ *                                             NULL for
+ *                                             unbounded
+ *                                             growth
+ *                                             without
+ *                                             shrinking.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - A segment length is
+ *                                       not a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 or max_length is below
+ *                                 min_length or above
+ *                                 Q2_GROW_MAX_LENGTH.
+ *    Q2_ERROR_ALLOCATION - The segment could not be
+ *                          allocated.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_grow_create(q2_grow_context_t* const ctx, uint32_t item_length, uint32_t min_length, const q2_grow_options_t* const options)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_grow_options_t defaults = { .max_length = Q2_GROW_MAX_LENGTH, .shrink = false };
+    const q2_grow_options_t* opts = (NULL == options) ? &defaults : options;
+    q2_grow_segment_t* segment;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(!((min_length & (min_length - 1)) == 0) || !min_length ||
+            !((opts->max_length & (opts->max_length - 1)) == 0) || !opts->max_length)
+    {
+        ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+    }
+    else if(0 == item_length || opts->max_length < min_length || opts->max_length > Q2_GROW_MAX_LENGTH)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        segment = q2_grow_segment_alloc(item_length, min_length);
+        if(NULL == segment)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            ctx->producer = segment;
+            ctx->tail_cache = 0;
+            atomic_store_explicit(&ctx->puts, 0, memory_order_relaxed);
+            ctx->consumer = segment;
+            ctx->head_cache = 0;
+            atomic_store_explicit(&ctx->gets, 0, memory_order_relaxed);
+            ctx->item_length = item_length;
+            ctx->min_length = min_length;
+            ctx->max_length = opts->max_length;
+            ctx->shrink = opts->shrink;
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_grow_destroy
+ *
+ * Description:
+ *    Frees every segment, dropping any queued items. Must
+ *    be called after the producer and consumer threads have
+ *    stopped.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Segments freed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_destroy(q2_grow_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_grow_segment_t* segment;
+    q2_grow_segment_t* next;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Every live segment is reachable from the consumer's */
+        segment = ctx->consumer;
+        while(NULL != segment)
+        {
+            next = atomic_load_explicit(&segment->next, memory_order_acquire);
+            free(segment);
+            segment = next;
+        }
+
+        ctx->producer = NULL;
+        ctx->consumer = NULL;
+        ctx->initialized = false;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_grow_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    When the segment is full the producer links a segment
+ *    twice as long and carries on there. With shrinking on,
+ *    each completed lap of a mostly empty segment moves to
+ *    one half as long. Must only be called from the producer
+ *    thread.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Segment is full at max_length.
+ *    Q2_ERROR_ALLOCATION - A larger segment could not be
+ *                          allocated.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_put(q2_grow_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_grow_segment_t* segment;
+    uint32_t head;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        segment = ctx->producer;
+        head = atomic_load_explicit(&segment->head, memory_order_relaxed);
+
+        /* Only touch the consumer's cache line when the cached tail says full */
+        if((head - ctx->tail_cache) == segment->max_length)
+        {
+            ctx->tail_cache = atomic_load_explicit(&segment->tail, memory_order_acquire);
+            if((head - ctx->tail_cache) == segment->max_length)
+            {
+                if(segment->max_length >= ctx->max_length)
+                {
+                    ret = Q2_ERROR_FULL;
+                }
+                else
+                {
+                    ret = q2_grow_link(ctx, segment->max_length * 2);
+                }
+            }
+        }
+
+        if(Q2_SUCCESS == ret && segment == ctx->producer && true == ctx->shrink &&
+           segment->max_length > ctx->min_length && 0 != head && 0 == (head & (segment->max_length - 1)))
+        {
+            /* A lap is done, move to a shorter segment if most of this one sat idle */
+            ctx->tail_cache = atomic_load_explicit(&segment->tail, memory_order_acquire);
+            if((head - ctx->tail_cache) <= (segment->max_length / 4))
+            {
+                /* Staying on the current segment is fine if the allocation fails */
+                (void)q2_grow_link(ctx, segment->max_length / 2);
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            segment = ctx->producer;
+            head = atomic_load_explicit(&segment->head, memory_order_relaxed);
+            memcpy(segment->data + ((size_t)(head & (segment->max_length - 1)) * ctx->item_length), input, ctx->item_length);
+
+            /* Count before publishing, so a get never sees the item ahead of its put */
+            atomic_store_explicit(&ctx->puts, atomic_load_explicit(&ctx->puts, memory_order_relaxed) + 1, memory_order_relaxed);
+            atomic_store_explicit(&segment->head, head + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_grow_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Moves to the next segment and frees the old one
+ *    once it is read out. Must only be called from the
+ *    consumer thread.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_get(q2_grow_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_grow_segment_t* segment;
+    q2_grow_segment_t* next = NULL;
+    uint32_t tail;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        segment = ctx->consumer;
+        tail = atomic_load_explicit(&segment->tail, memory_order_relaxed);
+
+        /* Only touch the producer's cache lines when the cached head says empty */
+        if(ctx->head_cache == tail)
+        {
+            ctx->head_cache = atomic_load_explicit(&segment->head, memory_order_acquire);
+            if(ctx->head_cache == tail)
+            {
+                next = atomic_load_explicit(&segment->next, memory_order_acquire);
+            }
+
+            while(NULL != next)
+            {
+                /* Head is final once the link is seen, recheck it before retiring the segment */
+                ctx->head_cache = atomic_load_explicit(&segment->head, memory_order_acquire);
+                if(ctx->head_cache == tail)
+                {
+                    ctx->consumer = next;
+                    free(segment);
+                    segment = next;
+                    tail = atomic_load_explicit(&segment->tail, memory_order_relaxed);
+                    ctx->head_cache = atomic_load_explicit(&segment->head, memory_order_acquire);
+                }
+
+                next = NULL;
+                if(ctx->head_cache == tail)
+                {
+                    next = atomic_load_explicit(&segment->next, memory_order_acquire);
+                }
+            }
+
+            if(ctx->head_cache == tail)
+            {
+                ret = Q2_ERROR_EMPTY;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy(output, segment->data + ((size_t)(tail & (segment->max_length - 1)) * ctx->item_length), ctx->item_length);
+            atomic_store_explicit(&segment->tail, tail + 1, memory_order_release);
+            atomic_store_explicit(&ctx->gets, atomic_load_explicit(&ctx->gets, memory_order_relaxed) + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_grow_length
+ *
+ * Description:
+ *    Returns the number of items queued over all segments.
+ *    The value is a snapshot and may be stale by the time
+ *    it is used.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_length(q2_grow_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t gets;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Gets is loaded first so it never passes puts */
+        gets = atomic_load_explicit(&ctx->gets, memory_order_acquire);
+        *length = atomic_load_explicit(&ctx->puts, memory_order_acquire) - gets;
+    }
+
+    return ret;
+}
@@ -0,0 +1,208 @@
+/**********************************************************
+ * Name:
+ *     q2_grow.h
+ *
+ * Description:
+ *     Header for lock-free single producer, single consumer
+ *     queue that grows and shrinks at runtime. Items live
+ *     in a chain of power of two segments. The producer
+ *     starts a larger segment when the current one is full
+ *     and the consumer frees each segment once it is read
+ *     out, so neither side ever stops the other.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_GROW_H
+#define Q2_GROW_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+/* Largest segment length, doubling past it would overflow the indices */
+#define Q2_GROW_MAX_LENGTH (0x80000000)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct q2_grow_segment
+{
+    /* Producer owned, head is published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+
+    /* Consumer owned, tail is published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+
+    /* Set once by the producer after its last put to this segment */
+    _Alignas(Q2_CACHE_LINE_SIZE) struct q2_grow_segment* _Atomic next;
+    uint32_t max_length;
+
+    /* Items follow the header, cache line aligned */
+    _Alignas(Q2_CACHE_LINE_SIZE) uint8_t data[];
+} q2_grow_segment_t;
+
+typedef struct
+{
+    /* Largest segment length, power of two */
+    uint32_t max_length;
+
+    /* Halve the segment when a lap finds it three quarters empty */
+    bool shrink;
+} q2_grow_options_t;
+
+typedef struct
+{
+    /* Producer owned, puts is published for the length */
+    _Alignas(Q2_CACHE_LINE_SIZE) q2_grow_segment_t* producer;
+    uint32_t tail_cache;
+    _Atomic uint32_t puts;
+
+    /* Consumer owned, gets is published for the length */
+    _Alignas(Q2_CACHE_LINE_SIZE) q2_grow_segment_t* consumer;
+    uint32_t head_cache;
+    _Atomic uint32_t gets;
+
+    /* Read only after create */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    uint32_t item_length;
+    uint32_t min_length;
+    uint32_t max_length;
+    bool shrink;
+} q2_grow_context_t;
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_grow_create
+ *
+ * Description:
+ *    Allocates the first segment, min_length items long,
+ *    and initializes the context. Must be called before the
+ *    producer and consumer threads are started.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t min_length - Starting and smallest segment
+ *                          length, power of two.
+ *    const q2_grow_options_t* const options - Growth
+ *                                             options, or
+ *                                             NULL for
+ *                                             unbounded
+ *                                             growth
+ *                                             without
+ *                                             shrinking.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - A segment length is
+ *                                       not a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 or max_length is below
+ *                                 min_length or above
+ *                                 Q2_GROW_MAX_LENGTH.
+ *    Q2_ERROR_ALLOCATION - The segment could not be
+ *                          allocated.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_grow_create(q2_grow_context_t* const ctx, uint32_t item_length, uint32_t min_length, const q2_grow_options_t* const options);
+
+/**********************************************************
+ * Name:
+ *    q2_grow_destroy
+ *
+ * Description:
+ *    Frees every segment, dropping any queued items. Must
+ *    be called after the producer and consumer threads have
+ *    stopped.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Segments freed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_destroy(q2_grow_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_grow_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    When the segment is full the producer links a segment
+ *    twice as long and carries on there. With shrinking on,
+ *    each completed lap of a mostly empty segment moves to
+ *    one half as long. Must only be called from the producer
+ *    thread.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Segment is full at max_length.
+ *    Q2_ERROR_ALLOCATION - A larger segment could not be
+ *                          allocated.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_put(q2_grow_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_grow_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Moves to the next segment and frees the old one
+ *    once it is read out. Must only be called from the
+ *    consumer thread.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_get(q2_grow_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_grow_length
+ *
+ * Description:
+ *    Returns the number of items queued over all segments.
+ *    The value is a snapshot and may be stale by the time
+ *    it is used.
+ *
+ * Parameters:
+ *    q2_grow_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 grow create has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_grow_length(q2_grow_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_GROW_H
@@ -0,0 +1,250 @@
+/**********************************************************
+ * Name:
+ *     q2_lossy.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer, single
+ *     consumer power of two queue that overwrites the oldest
+ *     items. Each slot holds a sequence number: even while
+ *     the item at index i is written, 2 * i + 1 once it is
+ *     complete. The consumer reads like a seqlock and checks
+ *     the number before and after copying.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_lossy.h"
+#include <string.h>
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_lossy_init
+ *
+ * Description:
+ *    Initializes the lossy context. Checks that the queue
+ *    length is a power of two and clears the slot sequence
+ *    numbers. Must be called before the producer and
+ *    consumer threads are started.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_lossy_init(q2_lossy_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t i;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Check for power of two */
+        if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else
+        {
+            for(i = 0; i < ctx->max_length; i++)
+            {
+                atomic_store_explicit(&ctx->sequence[i], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+            ctx->tail = 0;
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index,
+ *    overwriting the oldest item if the consumer has fallen
+ *    a full queue behind. Never fails for lack of space.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_put(q2_lossy_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        uint32_t head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        uint32_t slot = head & (ctx->max_length - 1);
+
+        /* Mark the slot as being written before the old item is touched */
+        atomic_store_explicit(&ctx->sequence[slot], head * 2, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        memcpy((uint8_t*)ctx->data + (slot * ctx->item_length), input, ctx->item_length);
+        atomic_store_explicit(&ctx->sequence[slot], (head * 2) + 1, memory_order_release);
+        atomic_store_explicit(&ctx->head, head + 1, memory_order_release);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_get
+ *
+ * Description:
+ *    Gets the oldest item that has not been overwritten.
+ *    Items overwritten before or while they were being read
+ *    are skipped and counted in lost. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t* const lost - Number of items skipped since
+ *                           the previous get.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty, lost may be non zero.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or lost is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_get(q2_lossy_context_t* const ctx, void* const output, uint32_t* const lost)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+    uint32_t slot;
+    uint32_t sequence;
+    bool copied = false;
+
+    if(NULL == ctx || NULL == output || NULL == lost)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *lost = 0;
+        while(Q2_SUCCESS == ret && false == copied)
+        {
+            head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+            if(head == ctx->tail)
+            {
+                ret = Q2_ERROR_EMPTY;
+            }
+            else
+            {
+                /* Jump over everything the producer has lapped */
+                if(head - ctx->tail > ctx->max_length)
+                {
+                    *lost += head - ctx->max_length - ctx->tail;
+                    ctx->tail = head - ctx->max_length;
+                }
+
+                slot = ctx->tail & (ctx->max_length - 1);
+                sequence = atomic_load_explicit(&ctx->sequence[slot], memory_order_acquire);
+                if((ctx->tail * 2) + 1 == sequence)
+                {
+                    memcpy(output, (uint8_t*)ctx->data + (slot * ctx->item_length), ctx->item_length);
+                    atomic_thread_fence(memory_order_acquire);
+                    copied = (sequence == atomic_load_explicit(&ctx->sequence[slot], memory_order_relaxed));
+                }
+
+                /* Either way this index is done, if the copy was torn the item is lost */
+                if(false == copied)
+                {
+                    *lost += 1;
+                }
+                ctx->tail++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_length
+ *
+ * Description:
+ *    Returns the number of items the consumer can still
+ *    read, at most the queue length. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_length(q2_lossy_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *length = atomic_load_explicit(&ctx->head, memory_order_acquire) - ctx->tail;
+        if(*length > ctx->max_length)
+        {
+            *length = ctx->max_length;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,151 @@
+/**********************************************************
+ * Name:
+ *     q2_lossy.h
+ *
+ * Description:
+ *     Header for lock-free single producer, single consumer
+ *     power of two queue that overwrites the oldest items.
+ *     The producer never waits, each slot carries a
+ *     sequence number so the consumer can count lost items.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_LOSSY_H
+#define Q2_LOSSY_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Producer owned, head is published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+
+    /* Consumer owned, never read by the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) uint32_t tail;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    void* data;
+    _Atomic uint32_t* sequence;
+    uint32_t max_length;
+    uint32_t item_length;
+} q2_lossy_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_LOSSY(context_name, struct_type, queue_size) \
+        static struct_type context_name##_array[queue_size]; \
+        static _Atomic uint32_t context_name##_sequence[queue_size]; \
+        static q2_lossy_context_t context_name = { \
+            .head = 0, \
+            .tail = 0, \
+            .initialized = false, \
+            .data = context_name##_array, \
+            .sequence = context_name##_sequence, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_lossy_init
+ *
+ * Description:
+ *    Initializes the lossy context. Checks that the queue
+ *    length is a power of two and clears the slot sequence
+ *    numbers. Must be called before the producer and
+ *    consumer threads are started.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_lossy_init(q2_lossy_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index,
+ *    overwriting the oldest item if the consumer has fallen
+ *    a full queue behind. Never fails for lack of space.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_put(q2_lossy_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_get
+ *
+ * Description:
+ *    Gets the oldest item that has not been overwritten.
+ *    Items overwritten before or while they were being read
+ *    are skipped and counted in lost. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t* const lost - Number of items skipped since
+ *                           the previous get.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty, lost may be non zero.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or lost is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_get(q2_lossy_context_t* const ctx, void* const output, uint32_t* const lost);
+
+/**********************************************************
+ * Name:
+ *    q2_lossy_length
+ *
+ * Description:
+ *    Returns the number of items the consumer can still
+ *    read, at most the queue length. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_lossy_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 lossy init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_lossy_length(q2_lossy_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_LOSSY_H
@@ -0,0 +1,276 @@
+/**********************************************************
+ * Name:
+ *     q2_mpmc.c
+ *
+ * Description:
+ *     Implementation for bounded lock-free multi producer,
+ *     multi consumer power of two queue. Every slot carries
+ *     a sequence number: a slot is free for ticket n when its
+ *     sequence equals n, and holds the item for ticket n when
+ *     its sequence equals n + 1.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_mpmc.h"
+#include <string.h>
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_mpmc_init
+ *
+ * Description:
+ *    Initializes the mpmc context and its slot sequence
+ *    numbers. Checks that the queue length is a power of
+ *    two. Must be called before any thread uses the queue.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_mpmc_init(q2_mpmc_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t i;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Check for power of two */
+        if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else
+        {
+            for(i = 0; i < ctx->max_length; i++)
+            {
+                atomic_store_explicit(&ctx->sequence[i], i, memory_order_relaxed);
+            }
+            atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->tail, 0, memory_order_relaxed);
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_put
+ *
+ * Description:
+ *    Claims a head ticket and adds an item to the queue.
+ *    Safe to call from any number of threads.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_put(q2_mpmc_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    bool claimed = false;
+    uint32_t head;
+    uint32_t sequence;
+    int32_t diff;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+
+        while(Q2_SUCCESS == ret && false == claimed)
+        {
+            sequence = atomic_load_explicit(&ctx->sequence[head & (ctx->max_length - 1)], memory_order_acquire);
+            diff = (int32_t)(sequence - head);
+
+            if(0 == diff)
+            {
+                /* Slot is free for this ticket, a failed CAS reloads head */
+                claimed = atomic_compare_exchange_weak_explicit(&ctx->head, &head, head + 1,
+                                                                memory_order_relaxed, memory_order_relaxed);
+            }
+            else if(diff < 0)
+            {
+                /* Slot still holds the item from the previous lap */
+                ret = Q2_ERROR_FULL;
+            }
+            else
+            {
+                /* Another producer took this ticket */
+                head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy((uint8_t*)ctx->data + ((head & (ctx->max_length - 1)) * ctx->item_length), input, ctx->item_length);
+            atomic_store_explicit(&ctx->sequence[head & (ctx->max_length - 1)], head + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_get
+ *
+ * Description:
+ *    Claims a tail ticket and gets an item from the queue.
+ *    Safe to call from any number of threads.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_get(q2_mpmc_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    bool claimed = false;
+    uint32_t tail;
+    uint32_t sequence;
+    int32_t diff;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+
+        while(Q2_SUCCESS == ret && false == claimed)
+        {
+            sequence = atomic_load_explicit(&ctx->sequence[tail & (ctx->max_length - 1)], memory_order_acquire);
+            diff = (int32_t)(sequence - (tail + 1));
+
+            if(0 == diff)
+            {
+                /* Slot holds the item for this ticket, a failed CAS reloads tail */
+                claimed = atomic_compare_exchange_weak_explicit(&ctx->tail, &tail, tail + 1,
+                                                                memory_order_relaxed, memory_order_relaxed);
+            }
+            else if(diff < 0)
+            {
+                /* Slot has not been published for this lap yet */
+                ret = Q2_ERROR_EMPTY;
+            }
+            else
+            {
+                /* Another consumer took this ticket */
+                tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy(output, (uint8_t*)ctx->data + ((tail & (ctx->max_length - 1)) * ctx->item_length), ctx->item_length);
+            atomic_store_explicit(&ctx->sequence[tail & (ctx->max_length - 1)], tail + ctx->max_length, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_length
+ *
+ * Description:
+ *    Returns the approximate length of the queue. Items
+ *    whose put or get is still in flight are counted.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_length(q2_mpmc_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+    uint32_t tail;
+    int32_t diff;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+        head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        diff = (int32_t)(head - tail);
+
+        /* Clamp for tickets claimed between the two loads */
+        if(diff < 0)
+        {
+            *length = 0;
+        }
+        else if((uint32_t)diff > ctx->max_length)
+        {
+            *length = ctx->max_length;
+        }
+        else
+        {
+            *length = (uint32_t)diff;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,141 @@
+/**********************************************************
+ * Name:
+ *     q2_mpmc.h
+ *
+ * Description:
+ *     Header for bounded lock-free multi producer, multi
+ *     consumer power of two queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_MPMC_H
+#define Q2_MPMC_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Producer ticket, claimed with CAS */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+
+    /* Consumer ticket, claimed with CAS */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    void* data;
+    _Atomic uint32_t* sequence;
+    uint32_t max_length;
+    uint32_t item_length;
+} q2_mpmc_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_MPMC(context_name, struct_type, queue_size) \
+        static struct_type context_name##_array[queue_size]; \
+        static _Atomic uint32_t context_name##_sequence[queue_size]; \
+        static q2_mpmc_context_t context_name = { \
+            .head = 0, \
+            .tail = 0, \
+            .initialized = false, \
+            .data = context_name##_array, \
+            .sequence = context_name##_sequence, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_mpmc_init
+ *
+ * Description:
+ *    Initializes the mpmc context and its slot sequence
+ *    numbers. Checks that the queue length is a power of
+ *    two. Must be called before any thread uses the queue.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_mpmc_init(q2_mpmc_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_put
+ *
+ * Description:
+ *    Claims a head ticket and adds an item to the queue.
+ *    Safe to call from any number of threads.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_put(q2_mpmc_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_get
+ *
+ * Description:
+ *    Claims a tail ticket and gets an item from the queue.
+ *    Safe to call from any number of threads.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_get(q2_mpmc_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_mpmc_length
+ *
+ * Description:
+ *    Returns the approximate length of the queue. Items
+ *    whose put or get is still in flight are counted.
+ *
+ * Parameters:
+ *    q2_mpmc_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 mpmc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_mpmc_length(q2_mpmc_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_MPMC_H
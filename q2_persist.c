@@ -0,0 +1,688 @@
+/**********************************************************
+ * Name:
+ *     q2_persist.c
+ *
+ * Description:
+ *     Implementation for power of two queue backed by a
+ *     memory mapped file. Items are copied straight into the
+ *     mapping, then the free running head and tail are
+ *     committed to the older of two checksummed slots. On
+ *     reopen the valid slot with the higher sequence wins.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_persist.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_PERSIST_FNV_OFFSET (0x811C9DC5)
+#define Q2_PERSIST_FNV_PRIME  (0x01000193)
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_persist_hash
+ *
+ * Description:
+ *    Folds length bytes into a running FNV-1a hash.
+ *
+ * Parameters:
+ *    uint32_t hash - Hash so far.
+ *    const void* const data - Bytes to fold in.
+ *    size_t length - Number of bytes.
+ *
+ * Returns:
+ *    Updated hash.
+ *********************************************************/
+static uint32_t q2_persist_hash(uint32_t hash, const void* const data, size_t length)
+{
+    const uint8_t* bytes = data;
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * Q2_PERSIST_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_header_checksum
+ *
+ * Description:
+ *    Returns the checksum of the header's geometry fields.
+ *
+ * Parameters:
+ *    const q2_persist_header_t* const header - File header.
+ *
+ * Returns:
+ *    Checksum to store in or compare with header checksum.
+ *********************************************************/
+static uint32_t q2_persist_header_checksum(const q2_persist_header_t* const header)
+{
+    uint32_t hash = Q2_PERSIST_FNV_OFFSET;
+
+    hash = q2_persist_hash(hash, &header->magic, sizeof(header->magic));
+    hash = q2_persist_hash(hash, &header->version, sizeof(header->version));
+    hash = q2_persist_hash(hash, &header->item_length, sizeof(header->item_length));
+    hash = q2_persist_hash(hash, &header->max_length, sizeof(header->max_length));
+    hash = q2_persist_hash(hash, &header->data_offset, sizeof(header->data_offset));
+    hash = q2_persist_hash(hash, &header->file_length, sizeof(header->file_length));
+
+    return hash;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_commit_checksum
+ *
+ * Description:
+ *    Returns the checksum of a commit slot's fields.
+ *
+ * Parameters:
+ *    const q2_persist_commit_t* const commit - Commit slot.
+ *
+ * Returns:
+ *    Checksum to store in or compare with commit checksum.
+ *********************************************************/
+static uint32_t q2_persist_commit_checksum(const q2_persist_commit_t* const commit)
+{
+    uint32_t hash = Q2_PERSIST_FNV_OFFSET;
+
+    hash = q2_persist_hash(hash, &commit->sequence, sizeof(commit->sequence));
+    hash = q2_persist_hash(hash, &commit->head, sizeof(commit->head));
+    hash = q2_persist_hash(hash, &commit->tail, sizeof(commit->tail));
+
+    return hash;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_write_commit
+ *
+ * Description:
+ *    Writes head and tail to the older commit slot. From
+ *    here on the slots between tail and head may be read
+ *    back after a restart, so they must not be reused until
+ *    a newer commit moves the tail past them.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *********************************************************/
+static void q2_persist_write_commit(q2_persist_context_t* const ctx)
+{
+    q2_persist_commit_t* commit;
+
+    ctx->sequence++;
+    commit = &ctx->header->commits[ctx->sequence & 1];
+    commit->sequence = ctx->sequence;
+    commit->head = ctx->head;
+    commit->tail = ctx->tail;
+    commit->checksum = q2_persist_commit_checksum(commit);
+    ctx->committed_tail = ctx->tail;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_sync
+ *
+ * Description:
+ *    Writes the items back with msync, then commits head
+ *    and tail and writes the header back. The header page
+ *    only changes after the items are on disk, so writeback
+ *    of the header can never get ahead of them.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - msync failed, see errno.
+ *    Q2_SUCCESS - Queue written back.
+ *********************************************************/
+static q2_return_t q2_persist_sync(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    size_t data_offset = (size_t)ctx->header->data_offset;
+
+    if(0 != msync(ctx->data, ctx->file_length - data_offset, MS_SYNC))
+    {
+        ret = Q2_ERROR_IO;
+    }
+    else
+    {
+        q2_persist_write_commit(ctx);
+        if(0 != msync(ctx->header, data_offset, MS_SYNC))
+        {
+            ret = Q2_ERROR_IO;
+        }
+        else
+        {
+            ctx->unflushed = 0;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_commit
+ *
+ * Description:
+ *    Records a put or get. Without a flush policy head and
+ *    tail are committed straight to the header. Otherwise
+ *    they are only committed by the next flush, which this
+ *    runs when the policy asks for it.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - Periodic flush failed, see errno.
+ *    Q2_SUCCESS - Committed.
+ *********************************************************/
+static q2_return_t q2_persist_commit(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(Q2_PERSIST_FLUSH_NONE == ctx->flush)
+    {
+        q2_persist_write_commit(ctx);
+    }
+    else
+    {
+        ctx->unflushed++;
+        if(Q2_PERSIST_FLUSH_EVERY_N == ctx->flush && ctx->unflushed >= ctx->flush_interval)
+        {
+            ret = q2_persist_sync(ctx);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_recover
+ *
+ * Description:
+ *    Checks an existing file's header against the handle's
+ *    geometry and loads the newest valid commit.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle with the file
+ *                                      mapped.
+ *
+ * Returns:
+ *    Q2_ERROR_INCOMPATIBLE - File is not a q2 queue, its
+ *                            geometry differs, or no commit
+ *                            is valid.
+ *    Q2_SUCCESS - Head and tail recovered.
+ *********************************************************/
+static q2_return_t q2_persist_recover(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_persist_header_t* header = ctx->header;
+    const q2_persist_commit_t* commit = NULL;
+    const q2_persist_commit_t* candidate;
+    uint32_t i;
+
+    if(Q2_PERSIST_MAGIC != header->magic ||
+       Q2_PERSIST_VERSION != header->version ||
+       ctx->item_length != header->item_length ||
+       ctx->max_length != header->max_length ||
+       ctx->file_length != header->file_length ||
+       (size_t)((uint8_t*)ctx->data - (uint8_t*)header) != header->data_offset ||
+       q2_persist_header_checksum(header) != header->checksum)
+    {
+        ret = Q2_ERROR_INCOMPATIBLE;
+    }
+
+    for(i = 0; Q2_SUCCESS == ret && i < 2; i++)
+    {
+        candidate = &header->commits[i];
+        if(q2_persist_commit_checksum(candidate) == candidate->checksum &&
+           (candidate->head - candidate->tail) <= ctx->max_length &&
+           (NULL == commit || candidate->sequence > commit->sequence))
+        {
+            commit = candidate;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(NULL == commit)
+        {
+            ret = Q2_ERROR_INCOMPATIBLE;
+        }
+        else
+        {
+            ctx->head = commit->head;
+            ctx->tail = commit->tail;
+            ctx->committed_tail = commit->tail;
+            ctx->sequence = commit->sequence;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_format
+ *
+ * Description:
+ *    Writes the header of a new, zero filled file with an
+ *    empty first commit and syncs it. The magic is written
+ *    last, so a file cut short here is formatted again on
+ *    the next open.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle with the file
+ *                                      mapped.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - Header could not be synced, see errno.
+ *    Q2_SUCCESS - File formatted.
+ *********************************************************/
+static q2_return_t q2_persist_format(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_persist_header_t* header = ctx->header;
+
+    header->version = Q2_PERSIST_VERSION;
+    header->item_length = ctx->item_length;
+    header->max_length = ctx->max_length;
+    header->data_offset = (uint64_t)((uint8_t*)ctx->data - (uint8_t*)header);
+    header->file_length = ctx->file_length;
+    ctx->head = 0;
+    ctx->tail = 0;
+    ctx->sequence = 0;
+    q2_persist_write_commit(ctx);
+
+    header->magic = Q2_PERSIST_MAGIC;
+    header->checksum = q2_persist_header_checksum(header);
+    if(0 != msync(header, (size_t)header->data_offset, MS_SYNC))
+    {
+        ret = Q2_ERROR_IO;
+    }
+    ctx->unflushed = 0;
+
+    return ret;
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_persist_open
+ *
+ * Description:
+ *    Opens a file backed queue, creating the file when it
+ *    does not exist. An existing file must have the same
+ *    geometry and reopens at its newest valid commit, items
+ *    between tail and head are still queued.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle to initialize.
+ *    const char* const path - File to open or create.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *    const q2_persist_options_t* const options - Flush
+ *                                                options, or
+ *                                                NULL to
+ *                                                never flush.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or path is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 the buffer is too long, or
+ *                                 flush_interval is zero for
+ *                                 Q2_PERSIST_FLUSH_EVERY_N.
+ *    Q2_ERROR_ALLOCATION - File could not be opened, sized
+ *                          or mapped, see errno.
+ *    Q2_ERROR_INCOMPATIBLE - File is not a q2 queue, its
+ *                            geometry differs, or no commit
+ *                            is valid.
+ *    Q2_SUCCESS - Queue opened, handle initialized.
+ *********************************************************/
+uint32_t q2_persist_open(q2_persist_context_t* const ctx, const char* const path, uint32_t item_length, uint32_t max_length, const q2_persist_options_t* const options)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_persist_options_t defaults = { .flush = Q2_PERSIST_FLUSH_NONE, .flush_interval = 0 };
+    const q2_persist_options_t* opts = (NULL == options) ? &defaults : options;
+    size_t page_length = (size_t)sysconf(_SC_PAGESIZE);
+    size_t data_offset = ((sizeof(q2_persist_header_t) + page_length - 1) / page_length) * page_length;
+    size_t file_length = 0;
+    void* region = MAP_FAILED;
+    struct stat info;
+    int fd = -1;
+
+    if(NULL == ctx || NULL == path)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(!((max_length & (max_length - 1)) == 0) || !max_length)
+    {
+        ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+    }
+    else if(0 == item_length || (uint64_t)item_length * max_length > (uint64_t)(SIZE_MAX / 2) ||
+            opts->flush > Q2_PERSIST_FLUSH_ON_DEMAND ||
+            (Q2_PERSIST_FLUSH_EVERY_N == opts->flush && 0 == opts->flush_interval))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+    else
+    {
+        memset(ctx, 0x00, sizeof(q2_persist_context_t));
+        file_length = data_offset + ((size_t)item_length * max_length);
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        fd = open(path, O_RDWR | O_CREAT, 0600);
+        if(-1 == fd || 0 != fstat(fd, &info))
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else if(0 == info.st_size && 0 != ftruncate(fd, (off_t)file_length))
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else if(0 != info.st_size && (uint64_t)info.st_size != file_length)
+        {
+            ret = Q2_ERROR_INCOMPATIBLE;
+        }
+        else
+        {
+            region = mmap(NULL, file_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(MAP_FAILED == region)
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+        }
+
+        if(-1 != fd)
+        {
+            close(fd);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->header = region;
+        ctx->data = (uint8_t*)region + data_offset;
+        ctx->file_length = file_length;
+        ctx->max_length = max_length;
+        ctx->item_length = item_length;
+        ctx->flush = opts->flush;
+        ctx->flush_interval = opts->flush_interval;
+
+        /* New files are zero filled, including ones cut short while formatting */
+        if(0 == ctx->header->magic)
+        {
+            ret = q2_persist_format(ctx);
+        }
+        else
+        {
+            ret = q2_persist_recover(ctx);
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            ctx->initialized = true;
+        }
+        else
+        {
+            munmap(region, file_length);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_close
+ *
+ * Description:
+ *    Flushes the queue unless the policy is
+ *    Q2_PERSIST_FLUSH_NONE and unmaps the file. The file is
+ *    kept, reopening it recovers the queued items.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle to release.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - Flush failed, see errno. The file is
+ *                  still unmapped.
+ *    Q2_SUCCESS - Queue closed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_close(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else
+    {
+        if(Q2_PERSIST_FLUSH_NONE != ctx->flush)
+        {
+            ret = q2_persist_sync(ctx);
+        }
+        munmap(ctx->header, ctx->file_length);
+        ctx->initialized = false;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_put
+ *
+ * Description:
+ *    Adds an item to the queue and commits the head index,
+ *    or leaves it to the next flush under a flush policy.
+ *    A put into a slot still covered by the last commit
+ *    flushes first, so the committed items stay intact.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_ERROR_IO - A flush failed, see errno. The item was
+ *                  queued unless the flush before the put
+ *                  failed.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_put(q2_persist_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if((ctx->head - ctx->tail) == ctx->max_length)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else if((ctx->head - ctx->committed_tail) == ctx->max_length)
+        {
+            /* The slot still holds an item of the last commit, commit the gets first */
+            ret = q2_persist_sync(ctx);
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy((uint8_t*)ctx->data + ((size_t)Q2_INDEX(ctx, ctx->head) * ctx->item_length), input, ctx->item_length);
+            ctx->head++;
+            ret = q2_persist_commit(ctx);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_get
+ *
+ * Description:
+ *    Gets an item from the queue and commits the tail index,
+ *    or leaves it to the next flush under a flush policy.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_ERROR_IO - Item was retrieved but the periodic flush
+ *                  failed, see errno.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_get(q2_persist_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(ctx->head == ctx->tail)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        else
+        {
+            memcpy(output, (uint8_t*)ctx->data + ((size_t)Q2_INDEX(ctx, ctx->tail) * ctx->item_length), ctx->item_length);
+            ctx->tail++;
+            ret = q2_persist_commit(ctx);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_flush
+ *
+ * Description:
+ *    Writes the items back to the file with msync, then
+ *    commits head and tail and writes the header back, so
+ *    the queue survives a system crash as of this flush.
+ *    Changes made after the last flush may not.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - msync failed, see errno.
+ *    Q2_SUCCESS - Queue written back.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_flush(q2_persist_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ret = q2_persist_sync(ctx);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_persist_length
+ *
+ * Description:
+ *    Returns the current length of the queue.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_length(q2_persist_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *length = ctx->head - ctx->tail;
+    }
+
+    return ret;
+}
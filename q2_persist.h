@@ -0,0 +1,249 @@
+/**********************************************************
+ * Name:
+ *     q2_persist.h
+ *
+ * Description:
+ *     Header for power of two queue backed by a memory
+ *     mapped file. Head and tail are committed through a
+ *     checksummed header, so a reopened queue starts at the
+ *     last consistent commit. Without a flush policy every
+ *     put and get commits to the page cache, which survives
+ *     a process crash but not a system crash. With one the
+ *     header is only committed by a flush, after the items
+ *     it covers are on disk. A handle is not thread safe and
+ *     a file must only be open in one handle.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_PERSIST_H
+#define Q2_PERSIST_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stddef.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_PERSIST_MAGIC   (0x51325046)
+#define Q2_PERSIST_VERSION (1)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef enum
+{
+    /* Commit every change, never msync, only survives process crashes */
+    Q2_PERSIST_FLUSH_NONE = 0,
+
+    /* Commit and msync after every flush_interval puts and gets, and on close */
+    Q2_PERSIST_FLUSH_EVERY_N,
+
+    /* Commit and msync only on q2_persist_flush and on close */
+    Q2_PERSIST_FLUSH_ON_DEMAND
+} q2_persist_flush_t;
+
+typedef struct
+{
+    q2_persist_flush_t flush;
+    uint32_t flush_interval;
+} q2_persist_options_t;
+
+/* One commit slot, valid when checksum matches */
+typedef struct
+{
+    uint64_t sequence;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t checksum;
+} q2_persist_commit_t;
+
+/* Layout of the start of the file, data follows on the next page */
+typedef struct
+{
+    /* Written once when the file is created */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t item_length;
+    uint32_t max_length;
+    uint64_t data_offset;
+    uint64_t file_length;
+    uint32_t checksum;
+
+    /* Commits alternate between slots, so a torn one leaves the other */
+    _Alignas(Q2_CACHE_LINE_SIZE) q2_persist_commit_t commits[2];
+} q2_persist_header_t;
+
+typedef struct
+{
+    bool initialized;
+
+    q2_persist_header_t* header;
+    void* data;
+    size_t file_length;
+    uint32_t max_length;
+    uint32_t item_length;
+
+    /* Free running, committed to the header per the flush policy */
+    uint32_t head;
+    uint32_t tail;
+    uint64_t sequence;
+
+    /* Tail of the newest commit, slots from here to head are not reused */
+    uint32_t committed_tail;
+
+    q2_persist_flush_t flush;
+    uint32_t flush_interval;
+    uint32_t unflushed;
+} q2_persist_context_t;
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_persist_open
+ *
+ * Description:
+ *    Opens a file backed queue, creating the file when it
+ *    does not exist. An existing file must have the same
+ *    geometry and reopens at its newest valid commit, items
+ *    between tail and head are still queued.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle to initialize.
+ *    const char* const path - File to open or create.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *    const q2_persist_options_t* const options - Flush
+ *                                                options, or
+ *                                                NULL to
+ *                                                never flush.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or path is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 the buffer is too long, or
+ *                                 flush_interval is zero for
+ *                                 Q2_PERSIST_FLUSH_EVERY_N.
+ *    Q2_ERROR_ALLOCATION - File could not be opened, sized
+ *                          or mapped, see errno.
+ *    Q2_ERROR_INCOMPATIBLE - File is not a q2 queue, its
+ *                            geometry differs, or no commit
+ *                            is valid.
+ *    Q2_SUCCESS - Queue opened, handle initialized.
+ *********************************************************/
+uint32_t q2_persist_open(q2_persist_context_t* const ctx, const char* const path, uint32_t item_length, uint32_t max_length, const q2_persist_options_t* const options);
+
+/**********************************************************
+ * Name:
+ *    q2_persist_close
+ *
+ * Description:
+ *    Flushes the queue unless the policy is
+ *    Q2_PERSIST_FLUSH_NONE and unmaps the file. The file is
+ *    kept, reopening it recovers the queued items.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Handle to release.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - Flush failed, see errno. The file is
+ *                  still unmapped.
+ *    Q2_SUCCESS - Queue closed.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_close(q2_persist_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_persist_put
+ *
+ * Description:
+ *    Adds an item to the queue and commits the head index,
+ *    or leaves it to the next flush under a flush policy.
+ *    A put into a slot still covered by the last commit
+ *    flushes first, so the committed items stay intact.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_ERROR_IO - A flush failed, see errno. The item was
+ *                  queued unless the flush before the put
+ *                  failed.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_put(q2_persist_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_persist_get
+ *
+ * Description:
+ *    Gets an item from the queue and commits the tail index,
+ *    or leaves it to the next flush under a flush policy.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_ERROR_IO - Item was retrieved but the periodic flush
+ *                  failed, see errno.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_get(q2_persist_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_persist_flush
+ *
+ * Description:
+ *    Writes the items back to the file with msync, then
+ *    commits head and tail and writes the header back, so
+ *    the queue survives a system crash as of this flush.
+ *    Changes made after the last flush may not.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *
+ * Returns:
+ *    Q2_ERROR_IO - msync failed, see errno.
+ *    Q2_SUCCESS - Queue written back.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_flush(q2_persist_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_persist_length
+ *
+ * Description:
+ *    Returns the current length of the queue.
+ *
+ * Parameters:
+ *    q2_persist_context_t* const ctx - Pointer to the handle.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not opened.
+ *********************************************************/
+uint32_t q2_persist_length(q2_persist_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_PERSIST_H
@@ -0,0 +1,740 @@
+/**********************************************************
+ * Name:
+ *     q2_pool.c
+ *
+ * Description:
+ *     Implementation for thread pool built on q2 queues. A
+ *     worker runs its own deque first, then the shared
+ *     queue, then steals from the other workers, and parks
+ *     once all three are empty. A parking worker counts
+ *     itself in sleepers before its last look for work, and
+ *     a submitter checks sleepers after queueing, so one of
+ *     the two always sees the other.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#define _GNU_SOURCE
+#include "q2_pool.h"
+
+#if defined(__linux__)
+#include "q2_deque.h"
+#include "q2_mpmc.h"
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+/* Empty looks a worker makes before parking */
+#define Q2_POOL_SPIN (64)
+
+#define Q2_POOL_DEFAULT_WORKER_LENGTH (256)
+#define Q2_POOL_DEFAULT_SUBMIT_LENGTH (1024)
+
+/* Drain polls the counters at this interval */
+#define Q2_POOL_DRAIN_POLL_NS (50000)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_POOL_ROUND_UP(value, align) ((((value) + (align) - 1) / (align)) * (align))
+
+/* Counters have a single writer, so a plain increment is enough */
+#define Q2_POOL_COUNT(counter) \
+        atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + 1, memory_order_release)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Owner pushes and pops, other workers steal */
+    q2_deque_context_t deque;
+
+    /* Written only by the worker, read by stats and drain */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint64_t executed;
+    _Atomic uint64_t stolen;
+    _Atomic uint64_t parks;
+
+    /* Read only after create */
+    _Alignas(Q2_CACHE_LINE_SIZE) struct q2_pool* pool;
+    pthread_t thread;
+    uint32_t index;
+} q2_pool_worker_t;
+
+struct q2_pool
+{
+    q2_mpmc_context_t submit;
+
+    /* Bumped before a task is queued, so it never trails executed */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint64_t submitted;
+
+    /* Futex word parked workers sleep on */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t signal;
+    _Atomic uint32_t sleepers;
+    _Atomic bool stopping;
+
+    /* Read only after create */
+    _Alignas(Q2_CACHE_LINE_SIZE) q2_pool_worker_t* workers;
+    uint32_t worker_count;
+    uint32_t started;
+};
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+/* Worker running on this thread, NULL outside any pool */
+static _Thread_local q2_pool_worker_t* q2_pool_current = NULL;
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_pool_find
+ *
+ * Description:
+ *    Takes the next task for a worker from its own deque,
+ *    the shared queue or another worker's deque.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_pool_worker_t* const worker - Worker looking.
+ *    q2_task_t* const task - Location to copy the task to.
+ *
+ * Returns:
+ *    true if a task was found.
+ *********************************************************/
+static bool q2_pool_find(q2_pool_t* const pool, q2_pool_worker_t* const worker, q2_task_t* const task)
+{
+    bool found = (Q2_SUCCESS == q2_deque_pop(&worker->deque, task)) ||
+                 (Q2_SUCCESS == q2_mpmc_get(&pool->submit, task));
+    uint32_t i;
+
+    /* Start with the next worker so thieves spread over victims */
+    for(i = 1; i < pool->worker_count && false == found; i++)
+    {
+        found = (Q2_SUCCESS == q2_deque_steal(&pool->workers[(worker->index + i) % pool->worker_count].deque, task));
+        if(true == found)
+        {
+            Q2_POOL_COUNT(worker->stolen);
+        }
+    }
+
+    return found;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_wake
+ *
+ * Description:
+ *    Wakes up to count parked workers. Only makes a syscall
+ *    when a worker is parked.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    uint32_t count - Number of workers to wake.
+ *********************************************************/
+static void q2_pool_wake(q2_pool_t* const pool, uint32_t count)
+{
+    /* Pairs with the sleepers increment in q2_pool_park */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(0 != atomic_load_explicit(&pool->sleepers, memory_order_relaxed))
+    {
+        atomic_fetch_add_explicit(&pool->signal, 1, memory_order_release);
+        syscall(SYS_futex, (uint32_t*)&pool->signal, FUTEX_WAKE_PRIVATE, (count > INT_MAX) ? INT_MAX : (int)count, NULL, NULL, 0);
+    }
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_park
+ *
+ * Description:
+ *    Counts the worker as parked, takes a last look for
+ *    work and sleeps on the signal word if there is none.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_pool_worker_t* const worker - Worker parking.
+ *    q2_task_t* const task - Location to copy a task to.
+ *
+ * Returns:
+ *    true if a task was found instead of parking.
+ *********************************************************/
+static bool q2_pool_park(q2_pool_t* const pool, q2_pool_worker_t* const worker, q2_task_t* const task)
+{
+    bool found;
+    uint32_t signal;
+
+    atomic_fetch_add_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+    signal = atomic_load_explicit(&pool->signal, memory_order_acquire);
+
+    found = q2_pool_find(pool, worker, task);
+    if(false == found && false == atomic_load_explicit(&pool->stopping, memory_order_acquire))
+    {
+        Q2_POOL_COUNT(worker->parks);
+        syscall(SYS_futex, (uint32_t*)&pool->signal, FUTEX_WAIT_PRIVATE, signal, NULL, NULL, 0);
+    }
+
+    atomic_fetch_sub_explicit(&pool->sleepers, 1, memory_order_relaxed);
+
+    return found;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_worker_main
+ *
+ * Description:
+ *    Worker thread. Runs tasks until the pool is stopping
+ *    and no work is left anywhere.
+ *
+ * Parameters:
+ *    void* arg - Worker context.
+ *
+ * Returns:
+ *    NULL.
+ *********************************************************/
+static void* q2_pool_worker_main(void* arg)
+{
+    q2_pool_worker_t* worker = arg;
+    q2_pool_t* pool = worker->pool;
+    q2_task_t task;
+    uint32_t spin = 0;
+    bool found;
+    bool running = true;
+
+    q2_pool_current = worker;
+
+    while(true == running)
+    {
+        found = q2_pool_find(pool, worker, &task);
+        if(false == found)
+        {
+            if(true == atomic_load_explicit(&pool->stopping, memory_order_acquire))
+            {
+                running = false;
+            }
+            else if(spin < Q2_POOL_SPIN)
+            {
+                spin++;
+                Q2_CPU_RELAX();
+            }
+            else
+            {
+                found = q2_pool_park(pool, worker, &task);
+                spin = 0;
+            }
+        }
+
+        if(true == found)
+        {
+            task.fn(task.arg);
+            Q2_POOL_COUNT(worker->executed);
+            spin = 0;
+        }
+    }
+
+    q2_pool_current = NULL;
+
+    return NULL;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_cpu
+ *
+ * Description:
+ *    Returns the cpu a worker is pinned to, the (i mod n)-th
+ *    of the n cpus the process may run on.
+ *
+ * Parameters:
+ *    const cpu_set_t* const allowed - Process affinity.
+ *    uint32_t i - Worker index.
+ *
+ * Returns:
+ *    Cpu number.
+ *********************************************************/
+static int32_t q2_pool_cpu(const cpu_set_t* const allowed, uint32_t i)
+{
+    uint32_t skip = i % (uint32_t)CPU_COUNT(allowed);
+    int32_t cpu = 0;
+
+    while(!CPU_ISSET(cpu, allowed) || 0 != skip)
+    {
+        if(CPU_ISSET(cpu, allowed))
+        {
+            skip--;
+        }
+        cpu++;
+    }
+
+    return cpu;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_stop
+ *
+ * Description:
+ *    Stops and joins the started workers and frees all of
+ *    the pool's memory.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *********************************************************/
+static void q2_pool_stop(q2_pool_t* const pool)
+{
+    uint32_t i;
+
+    /* Same ordering as a submit, a worker about to park sees one or the other */
+    atomic_store_explicit(&pool->stopping, true, memory_order_seq_cst);
+    atomic_fetch_add_explicit(&pool->signal, 1, memory_order_seq_cst);
+    syscall(SYS_futex, (uint32_t*)&pool->signal, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+
+    for(i = 0; i < pool->started; i++)
+    {
+        (void)pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    if(NULL != pool->workers)
+    {
+        for(i = 0; i < pool->worker_count; i++)
+        {
+            free(pool->workers[i].deque.data);
+        }
+        free(pool->workers);
+    }
+    free(pool->submit.data);
+    free(pool->submit.sequence);
+    free(pool);
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_pool_create
+ *
+ * Description:
+ *    Allocates the pool's queues and starts its workers.
+ *
+ * Parameters:
+ *    q2_pool_t** const pool - Set to the new pool.
+ *    const q2_pool_options_t* const options - Pool options,
+ *                                             or NULL for
+ *                                             defaults.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - A queue length is
+ *                                       not a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are more than
+ *                                 Q2_POOL_MAX_WORKERS
+ *                                 workers.
+ *    Q2_ERROR_ALLOCATION - Memory or a worker thread could
+ *                          not be allocated.
+ *    Q2_SUCCESS - Pool created and workers started.
+ *********************************************************/
+uint32_t q2_pool_create(q2_pool_t** const pool, const q2_pool_options_t* const options)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_pool_options_t defaults = { .worker_count = 0, .worker_length = Q2_POOL_DEFAULT_WORKER_LENGTH, .submit_length = Q2_POOL_DEFAULT_SUBMIT_LENGTH, .pinned = false };
+    const q2_pool_options_t* opts = (NULL == options) ? &defaults : options;
+    q2_pool_t* new_pool = NULL;
+    q2_pool_worker_t* worker;
+    pthread_attr_t attr;
+    cpu_set_t allowed;
+    cpu_set_t cpu;
+    uint32_t worker_count = opts->worker_count;
+    int32_t n;
+    uint32_t i;
+
+    if(NULL == pool)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+        *pool = NULL;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(0 == worker_count)
+        {
+            n = (int32_t)sysconf(_SC_NPROCESSORS_ONLN);
+            worker_count = (n > 0) ? (uint32_t)n : 1;
+        }
+
+        if(!((opts->worker_length & (opts->worker_length - 1)) == 0) || !opts->worker_length ||
+           !((opts->submit_length & (opts->submit_length - 1)) == 0) || !opts->submit_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else if(worker_count > Q2_POOL_MAX_WORKERS)
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        new_pool = aligned_alloc(Q2_CACHE_LINE_SIZE, Q2_POOL_ROUND_UP(sizeof(q2_pool_t), Q2_CACHE_LINE_SIZE));
+        if(NULL == new_pool)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        memset(new_pool, 0x00, sizeof(q2_pool_t));
+        new_pool->worker_count = worker_count;
+        new_pool->submit.max_length = opts->submit_length;
+        new_pool->submit.item_length = sizeof(q2_task_t);
+        new_pool->submit.data = malloc(sizeof(q2_task_t) * opts->submit_length);
+        new_pool->submit.sequence = malloc(sizeof(_Atomic uint32_t) * opts->submit_length);
+        new_pool->workers = aligned_alloc(Q2_CACHE_LINE_SIZE, Q2_POOL_ROUND_UP(sizeof(q2_pool_worker_t) * worker_count, Q2_CACHE_LINE_SIZE));
+        if(NULL != new_pool->workers)
+        {
+            /* Cleared before any failure, stop frees every deque buffer */
+            memset(new_pool->workers, 0x00, sizeof(q2_pool_worker_t) * worker_count);
+        }
+
+        if(NULL == new_pool->submit.data || NULL == new_pool->submit.sequence || NULL == new_pool->workers)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            ret = q2_mpmc_init(&new_pool->submit);
+        }
+    }
+
+    for(i = 0; Q2_SUCCESS == ret && i < worker_count; i++)
+    {
+        worker = &new_pool->workers[i];
+        worker->pool = new_pool;
+        worker->index = i;
+        worker->deque.max_length = opts->worker_length;
+        worker->deque.item_length = sizeof(q2_task_t);
+        worker->deque.data = malloc(sizeof(q2_task_t) * opts->worker_length);
+        if(NULL == worker->deque.data)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            ret = q2_deque_init(&worker->deque);
+        }
+    }
+
+    if(Q2_SUCCESS == ret && true == opts->pinned && 0 != sched_getaffinity(0, sizeof(allowed), &allowed))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    for(i = 0; Q2_SUCCESS == ret && i < worker_count; i++)
+    {
+        if(0 != pthread_attr_init(&attr))
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            if(true == opts->pinned)
+            {
+                CPU_ZERO(&cpu);
+                CPU_SET(q2_pool_cpu(&allowed, i), &cpu);
+                (void)pthread_attr_setaffinity_np(&attr, sizeof(cpu), &cpu);
+            }
+
+            if(0 != pthread_create(&new_pool->workers[i].thread, &attr, q2_pool_worker_main, &new_pool->workers[i]))
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+            else
+            {
+                new_pool->started++;
+            }
+            (void)pthread_attr_destroy(&attr);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *pool = new_pool;
+    }
+    else if(NULL != new_pool)
+    {
+        q2_pool_stop(new_pool);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_submit
+ *
+ * Description:
+ *    Queues fn(arg) to run on a worker. From a worker of
+ *    the same pool the task goes on that worker's deque,
+ *    otherwise on the shared queue. Wakes a parked worker
+ *    only if one is parked.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_task_fn_t fn - Function to run.
+ *    void* const arg - Passed through to fn.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Submission queue is full.
+ *    Q2_SUCCESS - Task queued.
+ *    Q2_ERROR_NULL_PARAMETER - When pool or fn is NULL.
+ *********************************************************/
+uint32_t q2_pool_submit(q2_pool_t* const pool, q2_task_fn_t fn, void* const arg)
+{
+    q2_task_t task = { .fn = fn, .arg = arg };
+    uint32_t submitted;
+
+    return q2_pool_submit_n(pool, &task, 1, &submitted);
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_submit_n
+ *
+ * Description:
+ *    Queues up to count tasks in order, stopping at the
+ *    first that does not fit. Counters are updated and
+ *    parked workers woken once for the whole batch.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    const q2_task_t* const tasks - Tasks to queue.
+ *    uint32_t count - Number of tasks.
+ *    uint32_t* const submitted - Number of tasks queued.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No task could be queued.
+ *    Q2_SUCCESS - submitted tasks queued.
+ *    Q2_ERROR_NULL_PARAMETER - When pool, tasks or submitted
+ *                              is NULL, or a task has no fn.
+ *********************************************************/
+uint32_t q2_pool_submit_n(q2_pool_t* const pool, const q2_task_t* const tasks, uint32_t count, uint32_t* const submitted)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_pool_worker_t* worker = q2_pool_current;
+    uint32_t i;
+
+    if(NULL == pool || NULL == tasks || NULL == submitted)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    for(i = 0; Q2_SUCCESS == ret && i < count; i++)
+    {
+        if(NULL == tasks[i].fn)
+        {
+            ret = Q2_ERROR_NULL_PARAMETER;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Counted up front so drain can never see a task run before it was submitted */
+        atomic_fetch_add_explicit(&pool->submitted, count, memory_order_relaxed);
+
+        /* Inside the pool, keep the work local and let idle workers steal it */
+        i = 0;
+        if(NULL != worker && pool == worker->pool)
+        {
+            while(i < count && Q2_SUCCESS == q2_deque_push(&worker->deque, (void*)&tasks[i]))
+            {
+                i++;
+            }
+        }
+        while(i < count && Q2_SUCCESS == q2_mpmc_put(&pool->submit, (void*)&tasks[i]))
+        {
+            i++;
+        }
+
+        if(i < count)
+        {
+            atomic_fetch_sub_explicit(&pool->submitted, count - i, memory_order_relaxed);
+        }
+        if(0 == i && 0 != count)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            q2_pool_wake(pool, i);
+        }
+
+        *submitted = i;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_drain
+ *
+ * Description:
+ *    Waits until every task submitted so far, and every task
+ *    those tasks submit, has run. Must not be called from a
+ *    worker.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Tasks were still queued or running
+ *                       after timeout_us.
+ *    Q2_SUCCESS - Pool is idle.
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *********************************************************/
+uint32_t q2_pool_drain(q2_pool_t* const pool, uint32_t timeout_us)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const struct timespec poll = { .tv_sec = 0, .tv_nsec = Q2_POOL_DRAIN_POLL_NS };
+    uint64_t waited_ns = 0;
+    uint64_t executed;
+    uint32_t i;
+    bool idle = false;
+
+    if(NULL == pool)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    while(Q2_SUCCESS == ret && false == idle)
+    {
+        /* Executed is summed before submitted is read, so equal counts mean nothing was in flight */
+        executed = 0;
+        for(i = 0; i < pool->worker_count; i++)
+        {
+            executed += atomic_load_explicit(&pool->workers[i].executed, memory_order_acquire);
+        }
+        idle = (executed == atomic_load_explicit(&pool->submitted, memory_order_acquire));
+
+        if(false == idle)
+        {
+            if(Q2_WAIT_FOREVER != timeout_us && waited_ns >= ((uint64_t)timeout_us * 1000ull))
+            {
+                ret = Q2_ERROR_TIMEOUT;
+            }
+            else
+            {
+                (void)nanosleep(&poll, NULL);
+                waited_ns += Q2_POOL_DRAIN_POLL_NS;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_stats
+ *
+ * Description:
+ *    Copies the pool counters and the number of tasks
+ *    currently queued. Values are snapshots taken without
+ *    stopping the workers.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_pool_stats_t* const stats - Location to copy to.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully copied counters.
+ *    Q2_ERROR_NULL_PARAMETER - When pool or stats is NULL.
+ *********************************************************/
+uint32_t q2_pool_stats(q2_pool_t* const pool, q2_pool_stats_t* const stats)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t length;
+    uint32_t i;
+
+    if(NULL == pool || NULL == stats)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        memset(stats, 0x00, sizeof(q2_pool_stats_t));
+        for(i = 0; i < pool->worker_count; i++)
+        {
+            stats->executed += atomic_load_explicit(&pool->workers[i].executed, memory_order_relaxed);
+            stats->stolen += atomic_load_explicit(&pool->workers[i].stolen, memory_order_relaxed);
+            stats->parks += atomic_load_explicit(&pool->workers[i].parks, memory_order_relaxed);
+            (void)q2_deque_length(&pool->workers[i].deque, &length);
+            stats->queued += length;
+        }
+        stats->submitted = atomic_load_explicit(&pool->submitted, memory_order_relaxed);
+        (void)q2_mpmc_length(&pool->submit, &length);
+        stats->queued += length;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_pool_destroy
+ *
+ * Description:
+ *    Lets the workers run every queued task, stops and
+ *    joins them, then frees the pool. Nothing may be
+ *    submitted from outside the pool once this is called.
+ *    Must not be called from a worker.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pool from q2 pool create.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Pool stopped and freed.
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *********************************************************/
+uint32_t q2_pool_destroy(q2_pool_t* const pool)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == pool)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        q2_pool_stop(pool);
+    }
+
+    return ret;
+}
+#endif
@@ -0,0 +1,203 @@
+/**********************************************************
+ * Name:
+ *     q2_pool.h
+ *
+ * Description:
+ *     Header for thread pool built on q2 queues. Tasks are
+ *     submitted through a shared mpmc queue, each worker
+ *     keeps a work stealing deque for tasks submitted from
+ *     inside the pool, and idle workers park on a futex.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_POOL_H
+#define Q2_POOL_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+
+#if defined(__linux__)
+/**********************************************************
+ * Defines
+ *********************************************************/
+#ifndef Q2_POOL_MAX_WORKERS
+#define Q2_POOL_MAX_WORKERS (256)
+#endif
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef void (*q2_task_fn_t)(void* const arg);
+
+/* Tasks are queued by value */
+typedef struct
+{
+    q2_task_fn_t fn;
+    void* arg;
+} q2_task_t;
+
+typedef struct
+{
+    /* Zero for one worker per online cpu */
+    uint32_t worker_count;
+
+    /* Deque length per worker, power of two */
+    uint32_t worker_length;
+
+    /* Shared submission queue length, power of two */
+    uint32_t submit_length;
+
+    /* Pin worker i to the i-th cpu the process may run on */
+    bool pinned;
+} q2_pool_options_t;
+
+typedef struct
+{
+    uint64_t submitted;
+    uint64_t executed;
+    uint64_t stolen;
+    uint64_t parks;
+    uint32_t queued;
+} q2_pool_stats_t;
+
+typedef struct q2_pool q2_pool_t;
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_pool_create
+ *
+ * Description:
+ *    Allocates the pool's queues and starts its workers.
+ *
+ * Parameters:
+ *    q2_pool_t** const pool - Set to the new pool.
+ *    const q2_pool_options_t* const options - Pool options,
+ *                                             or NULL for
+ *                                             defaults.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - A queue length is
+ *                                       not a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are more than
+ *                                 Q2_POOL_MAX_WORKERS
+ *                                 workers.
+ *    Q2_ERROR_ALLOCATION - Memory or a worker thread could
+ *                          not be allocated.
+ *    Q2_SUCCESS - Pool created and workers started.
+ *********************************************************/
+uint32_t q2_pool_create(q2_pool_t** const pool, const q2_pool_options_t* const options);
+
+/**********************************************************
+ * Name:
+ *    q2_pool_submit
+ *
+ * Description:
+ *    Queues fn(arg) to run on a worker. From a worker of
+ *    the same pool the task goes on that worker's deque,
+ *    otherwise on the shared queue. Wakes a parked worker
+ *    only if one is parked.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_task_fn_t fn - Function to run.
+ *    void* const arg - Passed through to fn.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Submission queue is full.
+ *    Q2_SUCCESS - Task queued.
+ *    Q2_ERROR_NULL_PARAMETER - When pool or fn is NULL.
+ *********************************************************/
+uint32_t q2_pool_submit(q2_pool_t* const pool, q2_task_fn_t fn, void* const arg);
+
+/**********************************************************
+ * Name:
+ *    q2_pool_submit_n
+ *
+ * Description:
+ *    Queues up to count tasks in order, stopping at the
+ *    first that does not fit. Counters are updated and
+ *    parked workers woken once for the whole batch.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    const q2_task_t* const tasks - Tasks to queue.
+ *    uint32_t count - Number of tasks.
+ *    uint32_t* const submitted - Number of tasks queued.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No task could be queued.
+ *    Q2_SUCCESS - submitted tasks queued.
+ *    Q2_ERROR_NULL_PARAMETER - When pool, tasks or submitted
+ *                              is NULL, or a task has no fn.
+ *********************************************************/
+uint32_t q2_pool_submit_n(q2_pool_t* const pool, const q2_task_t* const tasks, uint32_t count, uint32_t* const submitted);
+
+/**********************************************************
+ * Name:
+ *    q2_pool_drain
+ *
+ * Description:
+ *    Waits until every task submitted so far, and every task
+ *    those tasks submit, has run. Must not be called from a
+ *    worker.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Tasks were still queued or running
+ *                       after timeout_us.
+ *    Q2_SUCCESS - Pool is idle.
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *********************************************************/
+uint32_t q2_pool_drain(q2_pool_t* const pool, uint32_t timeout_us);
+
+/**********************************************************
+ * Name:
+ *    q2_pool_stats
+ *
+ * Description:
+ *    Copies the pool counters and the number of tasks
+ *    currently queued. Values are snapshots taken without
+ *    stopping the workers.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pointer to the pool.
+ *    q2_pool_stats_t* const stats - Location to copy to.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully copied counters.
+ *    Q2_ERROR_NULL_PARAMETER - When pool or stats is NULL.
+ *********************************************************/
+uint32_t q2_pool_stats(q2_pool_t* const pool, q2_pool_stats_t* const stats);
+
+/**********************************************************
+ * Name:
+ *    q2_pool_destroy
+ *
+ * Description:
+ *    Lets the workers run every queued task, stops and
+ *    joins them, then frees the pool. Nothing may be
+ *    submitted from outside the pool once this is called.
+ *    Must not be called from a worker.
+ *
+ * Parameters:
+ *    q2_pool_t* const pool - Pool from q2 pool create.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Pool stopped and freed.
+ *    Q2_ERROR_NULL_PARAMETER - When pool is NULL.
+ *********************************************************/
+uint32_t q2_pool_destroy(q2_pool_t* const pool);
+#endif
+
+#endif // Q2_POOL_H
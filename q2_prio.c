@@ -0,0 +1,338 @@
+/**********************************************************
+ * Name:
+ *     q2_prio.c
+ *
+ * Description:
+ *     Implementation for priority queue built from up to 64
+ *     power of two queues. Bit n of the occupancy bitmap
+ *     mirrors whether level n is non-empty, so dispatch never
+ *     has to poll the levels.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_prio.h"
+#include <string.h>
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_prio_highest
+ *
+ * Description:
+ *    Returns the index of the highest set bit.
+ *
+ * Parameters:
+ *    uint64_t occupied - Bitmap, must not be zero.
+ *
+ * Returns:
+ *    Highest non-empty level.
+ *********************************************************/
+static inline uint32_t q2_prio_highest(uint64_t occupied)
+{
+#if defined(__GNUC__)
+    return 63u - (uint32_t)__builtin_clzll(occupied);
+#else
+    uint32_t level = 63;
+
+    while(0 == (occupied & (1ull << level)))
+    {
+        level--;
+    }
+
+    return level;
+#endif
+}
+
+/**********************************************************
+ * Name:
+ *    q2_prio_update
+ *
+ * Description:
+ *    Clears the level's bit once it has been drained.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    uint32_t level - Level that was read from.
+ *********************************************************/
+static void q2_prio_update(q2_prio_context_t* const ctx, uint32_t level)
+{
+    bool empty = false;
+
+    (void)q2_empty(&ctx->levels[level], &empty);
+    if(true == empty)
+    {
+        ctx->occupied &= ~(1ull << level);
+    }
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_prio_init
+ *
+ * Description:
+ *    Initializes the priority context and one q2 context per
+ *    level over the shared storage. All levels start empty.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are no levels or
+ *                                 more than 64.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_prio_init(q2_prio_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    q2_context_t* level;
+    uint32_t i;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(0 == ctx->level_count || ctx->level_count > Q2_PRIO_MAX_LEVELS)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    for(i = 0; Q2_SUCCESS == ret && i < ctx->level_count; i++)
+    {
+        level = &ctx->levels[i];
+        memset(level, 0x00, sizeof(q2_context_t));
+        level->data = (uint8_t*)ctx->data + ((size_t)i * ctx->max_length * ctx->item_length);
+        level->max_length = ctx->max_length;
+        level->item_length = ctx->item_length;
+
+        ret = q2_init(level);
+        if(Q2_SUCCESS == ret)
+        {
+            ret = q2_reset(level);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->occupied = 0;
+        ctx->initialized = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_prio_put
+ *
+ * Description:
+ *    Adds an item to the queue at the given level. Higher
+ *    levels are dequeued first.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    uint32_t level - Priority level, below level_count.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Level is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When level is out of range.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_put(q2_prio_context_t* const ctx, uint32_t level, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(level >= ctx->level_count)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ret = q2_put(&ctx->levels[level], input);
+        if(Q2_SUCCESS == ret)
+        {
+            ctx->occupied |= (1ull << level);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_prio_get
+ *
+ * Description:
+ *    Gets the oldest item from the highest non-empty level.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t* const level - Level the item came from.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - All levels are empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or level is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_get(q2_prio_context_t* const ctx, void* const output, uint32_t* const level)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == output || NULL == level)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(0 == ctx->occupied)
+    {
+        ret = Q2_ERROR_EMPTY;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *level = q2_prio_highest(ctx->occupied);
+        ret = q2_get(&ctx->levels[*level], output);
+        q2_prio_update(ctx, *level);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_prio_get_n
+ *
+ * Description:
+ *    Gets up to count items in priority order, draining the
+ *    highest non-empty level before moving down to the next.
+ *    Each level is copied with at most two copies.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    void* const output - Array to copy the items to.
+ *    uint32_t count - Number of items output can hold.
+ *    uint32_t* const transferred - Number of items retrieved.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - All levels are empty.
+ *    Q2_SUCCESS - Successfully retrieved transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_get_n(q2_prio_context_t* const ctx, void* const output, uint32_t count, uint32_t* const transferred)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t level;
+    uint32_t moved;
+
+    if(NULL == ctx || NULL == output || NULL == transferred)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *transferred = 0;
+        while(*transferred < count && 0 != ctx->occupied)
+        {
+            level = q2_prio_highest(ctx->occupied);
+            (void)q2_get_n(&ctx->levels[level], (uint8_t*)output + ((size_t)*transferred * ctx->item_length),
+                           count - *transferred, false, &moved);
+            *transferred += moved;
+            q2_prio_update(ctx, level);
+        }
+
+        if(0 == *transferred)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_prio_length
+ *
+ * Description:
+ *    Returns the number of items queued across all levels.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Total length of the queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_length(q2_prio_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint64_t occupied;
+    uint32_t level;
+    uint32_t level_length;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Only visit levels that hold items */
+        *length = 0;
+        occupied = ctx->occupied;
+        while(0 != occupied)
+        {
+            level = q2_prio_highest(occupied);
+            (void)q2_length(&ctx->levels[level], &level_length);
+            *length += level_length;
+            occupied &= ~(1ull << level);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,173 @@
+/**********************************************************
+ * Name:
+ *     q2_prio.h
+ *
+ * Description:
+ *     Header for priority queue built from up to 64 power of
+ *     two queues. An occupancy bitmap finds the highest
+ *     non-empty level with a single count leading zeros.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_PRIO_H
+#define Q2_PRIO_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_PRIO_MAX_LEVELS (64)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    bool initialized;
+
+    /* Bit n is set while level n holds items */
+    uint64_t occupied;
+
+    q2_context_t* levels;
+    uint32_t level_count;
+
+    /* Storage for all levels, level n starts at n * max_length items */
+    void* data;
+    uint32_t max_length;
+    uint32_t item_length;
+} q2_prio_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_PRIO(context_name, struct_type, queue_size, levels_size) \
+        static struct_type context_name##_array[levels_size][queue_size]; \
+        static q2_context_t context_name##_levels[levels_size]; \
+        static q2_prio_context_t context_name = { \
+            .initialized = false, \
+            .occupied = 0, \
+            .levels = context_name##_levels, \
+            .level_count = levels_size, \
+            .data = context_name##_array, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_prio_init
+ *
+ * Description:
+ *    Initializes the priority context and one q2 context per
+ *    level over the shared storage. All levels start empty.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are no levels or
+ *                                 more than 64.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_prio_init(q2_prio_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_prio_put
+ *
+ * Description:
+ *    Adds an item to the queue at the given level. Higher
+ *    levels are dequeued first.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    uint32_t level - Priority level, below level_count.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Level is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When level is out of range.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_put(q2_prio_context_t* const ctx, uint32_t level, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_prio_get
+ *
+ * Description:
+ *    Gets the oldest item from the highest non-empty level.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t* const level - Level the item came from.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - All levels are empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or level is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_get(q2_prio_context_t* const ctx, void* const output, uint32_t* const level);
+
+/**********************************************************
+ * Name:
+ *    q2_prio_get_n
+ *
+ * Description:
+ *    Gets up to count items in priority order, draining the
+ *    highest non-empty level before moving down to the next.
+ *    Each level is copied with at most two copies.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    void* const output - Array to copy the items to.
+ *    uint32_t count - Number of items output can hold.
+ *    uint32_t* const transferred - Number of items retrieved.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - All levels are empty.
+ *    Q2_SUCCESS - Successfully retrieved transferred items.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_get_n(q2_prio_context_t* const ctx, void* const output, uint32_t count, uint32_t* const transferred);
+
+/**********************************************************
+ * Name:
+ *    q2_prio_length
+ *
+ * Description:
+ *    Returns the number of items queued across all levels.
+ *
+ * Parameters:
+ *    q2_prio_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Total length of the queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 prio init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_prio_length(q2_prio_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_PRIO_H
@@ -0,0 +1,581 @@
+/**********************************************************
+ * Name:
+ *     q2_qset.c
+ *
+ * Description:
+ *     Implementation for queue sets. Bit i of the ready
+ *     bitmap is set by queue i's producer when it publishes
+ *     into an empty queue, and cleared by the consumer when it
+ *     finds the queue drained. Both sides fence between their
+ *     store and the other side's load, so an item published
+ *     while the bit is being cleared is never missed.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#define _GNU_SOURCE
+#include "q2_qset.h"
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_qset_lowest
+ *
+ * Description:
+ *    Returns the index of the lowest set bit.
+ *
+ * Parameters:
+ *    uint64_t bits - Bitmap word, must not be zero.
+ *
+ * Returns:
+ *    Lowest set bit.
+ *********************************************************/
+static inline uint32_t q2_qset_lowest(uint64_t bits)
+{
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_ctzll(bits);
+#else
+    uint32_t bit = 0;
+
+    while(0 == (bits & (1ull << bit)))
+    {
+        bit++;
+    }
+
+    return bit;
+#endif
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_pending
+ *
+ * Description:
+ *    Checks whether a queue with its ready bit set still
+ *    holds items. Clears the bit if it does not, then checks
+ *    again in case the producer published in between.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t index - Index of the queue in the set.
+ *
+ * Returns:
+ *    true if the queue holds items.
+ *********************************************************/
+static bool q2_qset_pending(q2_qset_context_t* const set, uint32_t index)
+{
+    _Atomic uint64_t* word = &set->ready[index / 64];
+    uint64_t bit = 1ull << (index % 64);
+    uint32_t length = 0;
+
+    (void)q2_spsc_length(set->members[index], &length);
+    if(0 == length)
+    {
+        atomic_fetch_and_explicit(word, ~bit, memory_order_relaxed);
+
+        /* Pairs with the fence in q2_qset_signal */
+        atomic_thread_fence(memory_order_seq_cst);
+
+        (void)q2_spsc_length(set->members[index], &length);
+        if(0 != length)
+        {
+            atomic_fetch_or_explicit(word, bit, memory_order_relaxed);
+        }
+    }
+
+    return (0 != length);
+}
+
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_qset_park
+ *
+ * Description:
+ *    Flags the consumer as waiting and sleeps on the set's
+ *    sequence while it still holds sequence. The flag is set
+ *    before the sequence is re-checked so a signal cannot be
+ *    missed.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t sequence - Sequence seen before the last poll.
+ *    uint64_t deadline - Monotonic deadline in nanoseconds,
+ *                        UINT64_MAX for no deadline.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Deadline has passed.
+ *    Q2_SUCCESS - Woken, or sequence changed before sleeping.
+ *********************************************************/
+static q2_return_t q2_qset_park(q2_qset_context_t* const set, uint32_t sequence, uint64_t deadline)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    struct timespec now;
+    struct timespec timeout;
+    struct timespec* timeout_ptr = NULL;
+    uint64_t now_ns;
+
+    if(UINT64_MAX != deadline)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now_ns = ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+        if(now_ns >= deadline)
+        {
+            ret = Q2_ERROR_TIMEOUT;
+        }
+        else
+        {
+            timeout.tv_sec = (time_t)((deadline - now_ns) / 1000000000ull);
+            timeout.tv_nsec = (long)((deadline - now_ns) % 1000000000ull);
+            timeout_ptr = &timeout;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        atomic_store_explicit(&set->waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if(sequence == atomic_load_explicit(&set->sequence, memory_order_relaxed) &&
+           -1 == syscall(SYS_futex, (uint32_t*)&set->sequence, FUTEX_WAIT_PRIVATE, sequence, timeout_ptr, NULL, 0) &&
+           ETIMEDOUT == errno)
+        {
+            ret = Q2_ERROR_TIMEOUT;
+        }
+
+        atomic_store_explicit(&set->waiting, 0, memory_order_relaxed);
+    }
+
+    return ret;
+}
+#endif
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_qset_init
+ *
+ * Description:
+ *    Initializes the queue set with no members. Must be
+ *    called before any queue is added.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When set is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the set has no room
+ *                                 for members.
+ *    Q2_SUCCESS - Set initialized.
+ *********************************************************/
+uint32_t q2_qset_init(q2_qset_context_t* const set)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t i;
+
+    if(NULL == set)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(0 == set->max_members)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        for(i = 0; i < (set->max_members + 63) / 64; i++)
+        {
+            atomic_store_explicit(&set->ready[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&set->sequence, 0, memory_order_relaxed);
+        atomic_store_explicit(&set->waiting, 0, memory_order_relaxed);
+        set->member_count = 0;
+        set->cursor = 0;
+        set->initialized = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_add
+ *
+ * Description:
+ *    Registers an initialized spsc queue with the set and
+ *    returns its index in the set. Must be called before the
+ *    queue's producer is started.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    q2_spsc_context_t* const queue - Queue to register.
+ *    uint32_t* const index - Index reported by wait and poll.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Set has no room for another queue.
+ *    Q2_SUCCESS - Queue registered.
+ *    Q2_ERROR_NULL_PARAMETER - When set, queue or index is
+ *                              NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the queue already
+ *                                 belongs to a set.
+ *    Q2_ERROR_NOT_INITIALIZED - When the set or queue has
+ *                               not been initialized.
+ *********************************************************/
+uint32_t q2_qset_add(q2_qset_context_t* const set, q2_spsc_context_t* const queue, uint32_t* const index)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t length = 0;
+
+    if(NULL == set || NULL == queue || NULL == index)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == set->initialized || false == queue->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(NULL != queue->qset)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+    else if(set->member_count == set->max_members)
+    {
+        ret = Q2_ERROR_FULL;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *index = set->member_count;
+        set->members[*index] = queue;
+        set->member_count++;
+        queue->qset_index = *index;
+        queue->qset = set;
+
+        /* Items put before joining never saw the set */
+        (void)q2_spsc_length(queue, &length);
+        if(0 != length)
+        {
+            q2_qset_signal(set, *index);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_poll
+ *
+ * Description:
+ *    Returns the indices of member queues that hold items,
+ *    without waiting. Stale ready bits of drained queues are
+ *    cleared along the way. Each call resumes the scan just
+ *    after the last index returned and wraps around, so no
+ *    queue is starved when capacity is small. Must only be
+ *    called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t* const ready - Array to write the indices to.
+ *    uint32_t capacity - Number of indices ready can hold.
+ *    uint32_t* const count - Number of indices written.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - No member queue holds items.
+ *    Q2_SUCCESS - count indices written.
+ *    Q2_ERROR_NULL_PARAMETER - When set, ready or count is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_poll(q2_qset_context_t* const set, uint32_t* const ready, uint32_t capacity, uint32_t* const count)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t words;
+    uint32_t word;
+    uint32_t start;
+    uint32_t index;
+    uint64_t bits;
+    uint32_t i;
+
+    if(NULL == set || NULL == ready || NULL == count)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == set->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *count = 0;
+        words = (set->member_count + 63) / 64;
+        start = (set->cursor < set->member_count) ? set->cursor : 0;
+
+        /* Bits from the cursor up first, the low bits of its word last after the wrap */
+        for(i = 0; 0 != words && i <= words && *count < capacity; i++)
+        {
+            word = ((start / 64) + i) % words;
+            bits = atomic_load_explicit(&set->ready[word], memory_order_acquire);
+            if(0 == i)
+            {
+                bits &= ~0ULL << (start % 64);
+            }
+            else if(words == i)
+            {
+                bits &= ~(~0ULL << (start % 64));
+            }
+
+            while(0 != bits && *count < capacity)
+            {
+                index = (word * 64) + q2_qset_lowest(bits);
+                bits &= bits - 1;
+                if(true == q2_qset_pending(set, index))
+                {
+                    ready[*count] = index;
+                    *count += 1;
+                    set->cursor = index + 1;
+                }
+            }
+        }
+
+        if(0 == *count)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_signal
+ *
+ * Description:
+ *    Marks a member queue ready and wakes the consumer. Called
+ *    by q2_spsc_put after every put. Each call issues a full
+ *    fence, which the consumer needs to see the item before
+ *    it clears a stale bit. Shared state is only written when
+ *    the ready bit was clear.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t index - Index of the queue in the set.
+ *********************************************************/
+void q2_qset_signal(q2_qset_context_t* const set, uint32_t index)
+{
+    _Atomic uint64_t* word = &set->ready[index / 64];
+    uint64_t bit = 1ull << (index % 64);
+#if defined(__linux__)
+    uint64_t one = 1;
+    int fd;
+#endif
+
+    /* Pairs with the fence in q2_qset_pending, orders the head store before the bit load */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(0 == (atomic_load_explicit(word, memory_order_relaxed) & bit))
+    {
+        atomic_fetch_or_explicit(word, bit, memory_order_release);
+        atomic_fetch_add_explicit(&set->sequence, 1, memory_order_release);
+
+#if defined(__linux__)
+        /* Pairs with the fence in q2_qset_park */
+        atomic_thread_fence(memory_order_seq_cst);
+        if(0 != atomic_load_explicit(&set->waiting, memory_order_relaxed))
+        {
+            syscall(SYS_futex, (uint32_t*)&set->sequence, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        }
+
+        /* Pairs with the store in q2_qset_eventfd */
+        fd = atomic_load_explicit(&set->eventfd, memory_order_acquire);
+        if(-1 != fd)
+        {
+            (void)write(fd, &one, sizeof(one));
+        }
+#endif
+    }
+}
+
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_qset_wait
+ *
+ * Description:
+ *    Returns the indices of member queues that hold items,
+ *    parking on a futex until one does. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t* const ready - Array to write the indices to.
+ *    uint32_t capacity - Number of indices ready can hold.
+ *    uint32_t* const count - Number of indices written.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - No queue held items for timeout_us.
+ *    Q2_SUCCESS - count indices written.
+ *    Q2_ERROR_NULL_PARAMETER - When set, ready or count is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_wait(q2_qset_context_t* const set, uint32_t* const ready, uint32_t capacity, uint32_t* const count, uint32_t timeout_us)
+{
+    q2_return_t ret = Q2_ERROR_EMPTY;
+    struct timespec now;
+    uint64_t deadline = UINT64_MAX;
+    uint32_t sequence;
+
+    if(Q2_WAIT_FOREVER != timeout_us)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        deadline = ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec + ((uint64_t)timeout_us * 1000ull);
+    }
+
+    while(Q2_ERROR_EMPTY == ret)
+    {
+        /* Sampled before polling, any signal after the poll changes it */
+        sequence = (NULL != set) ? atomic_load_explicit(&set->sequence, memory_order_acquire) : 0;
+
+        ret = q2_qset_poll(set, ready, capacity, count);
+        if(Q2_ERROR_EMPTY == ret && Q2_ERROR_TIMEOUT == q2_qset_park(set, sequence, deadline))
+        {
+            ret = q2_qset_poll(set, ready, capacity, count);
+            if(Q2_ERROR_EMPTY == ret)
+            {
+                ret = Q2_ERROR_TIMEOUT;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_eventfd
+ *
+ * Description:
+ *    Returns a non-blocking eventfd that becomes readable
+ *    whenever a member queue turns non-empty, for use with
+ *    epoll. The consumer reads the eventfd to reset it and
+ *    then calls q2_qset_poll. May be called while producers
+ *    run, but items put before it returns may not signal the
+ *    eventfd, so the consumer polls once after creating it.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    int* const fd - Location to store the descriptor.
+ *
+ * Returns:
+ *    Q2_ERROR_ALLOCATION - The eventfd could not be created.
+ *    Q2_SUCCESS - Descriptor stored in fd.
+ *    Q2_ERROR_NULL_PARAMETER - When set or fd is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_eventfd(q2_qset_context_t* const set, int* const fd)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    int created;
+
+    if(NULL == set || NULL == fd)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == set->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret && -1 == atomic_load_explicit(&set->eventfd, memory_order_relaxed))
+    {
+        created = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(-1 == created)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            /* Producers already running start writing to it from here on */
+            atomic_store_explicit(&set->eventfd, created, memory_order_release);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        *fd = atomic_load_explicit(&set->eventfd, memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_qset_eventfd_close
+ *
+ * Description:
+ *    Closes the set's eventfd, if one was created. Only legal
+ *    once the producers have stopped, a running producer may
+ *    still write to the descriptor after it is closed and
+ *    its number reused.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Eventfd closed.
+ *    Q2_ERROR_NULL_PARAMETER - When set is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_eventfd_close(q2_qset_context_t* const set)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    int fd = -1;
+
+    if(NULL == set)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == set->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        fd = atomic_exchange_explicit(&set->eventfd, -1, memory_order_relaxed);
+    }
+
+    if(-1 != fd)
+    {
+        (void)close(fd);
+    }
+
+    return ret;
+}
+#endif
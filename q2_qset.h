@@ -0,0 +1,237 @@
+/**********************************************************
+ * Name:
+ *     q2_qset.h
+ *
+ * Description:
+ *     Header for queue sets. A consumer registers any number
+ *     of spsc queues and then waits on all of them at once.
+ *     Every put to a member queue issues a full fence and
+ *     checks the queue's ready bit, setting it and waking the
+ *     consumer only when it was clear. The consumer never
+ *     scans idle queues, at the cost of one seq_cst fence per
+ *     put, a few nanoseconds uncontended.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_QSET_H
+#define Q2_QSET_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include "q2_spsc.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct q2_qset_context
+{
+    /* Bumped by producers when they set a ready bit, the consumer sleeps on it */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t sequence;
+    _Atomic uint32_t waiting;
+
+    /* Read only after the producers start, except the ready bits */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    q2_spsc_context_t** members;
+    _Atomic uint64_t* ready;
+    uint32_t member_count;
+    uint32_t max_members;
+
+    /* Consumer written, producers load it on every signal */
+    _Atomic int eventfd;
+
+    /* Consumer owned, member index the next scan starts at */
+    uint32_t cursor;
+} q2_qset_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_QSET(set_name, set_size) \
+        static q2_spsc_context_t* set_name##_members[set_size]; \
+        static _Atomic uint64_t set_name##_ready[((set_size) + 63) / 64]; \
+        static q2_qset_context_t set_name = { \
+            .sequence = 0, \
+            .waiting = 0, \
+            .initialized = false, \
+            .members = set_name##_members, \
+            .ready = set_name##_ready, \
+            .member_count = 0, \
+            .max_members = set_size, \
+            .eventfd = -1, \
+            .cursor = 0 \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_qset_init
+ *
+ * Description:
+ *    Initializes the queue set with no members. Must be
+ *    called before any queue is added.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When set is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the set has no room
+ *                                 for members.
+ *    Q2_SUCCESS - Set initialized.
+ *********************************************************/
+uint32_t q2_qset_init(q2_qset_context_t* const set);
+
+/**********************************************************
+ * Name:
+ *    q2_qset_add
+ *
+ * Description:
+ *    Registers an initialized spsc queue with the set and
+ *    returns its index in the set. Must be called before the
+ *    queue's producer is started.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    q2_spsc_context_t* const queue - Queue to register.
+ *    uint32_t* const index - Index reported by wait and poll.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Set has no room for another queue.
+ *    Q2_SUCCESS - Queue registered.
+ *    Q2_ERROR_NULL_PARAMETER - When set, queue or index is
+ *                              NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the queue already
+ *                                 belongs to a set.
+ *    Q2_ERROR_NOT_INITIALIZED - When the set or queue has
+ *                               not been initialized.
+ *********************************************************/
+uint32_t q2_qset_add(q2_qset_context_t* const set, q2_spsc_context_t* const queue, uint32_t* const index);
+
+/**********************************************************
+ * Name:
+ *    q2_qset_poll
+ *
+ * Description:
+ *    Returns the indices of member queues that hold items,
+ *    without waiting. Stale ready bits of drained queues are
+ *    cleared along the way. Each call resumes the scan just
+ *    after the last index returned and wraps around, so no
+ *    queue is starved when capacity is small. Must only be
+ *    called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t* const ready - Array to write the indices to.
+ *    uint32_t capacity - Number of indices ready can hold.
+ *    uint32_t* const count - Number of indices written.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - No member queue holds items.
+ *    Q2_SUCCESS - count indices written.
+ *    Q2_ERROR_NULL_PARAMETER - When set, ready or count is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_poll(q2_qset_context_t* const set, uint32_t* const ready, uint32_t capacity, uint32_t* const count);
+
+/**********************************************************
+ * Name:
+ *    q2_qset_signal
+ *
+ * Description:
+ *    Marks a member queue ready and wakes the consumer. Called
+ *    by q2_spsc_put after every put. Each call issues a full
+ *    fence, which the consumer needs to see the item before
+ *    it clears a stale bit. Shared state is only written when
+ *    the ready bit was clear.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t index - Index of the queue in the set.
+ *********************************************************/
+void q2_qset_signal(q2_qset_context_t* const set, uint32_t index);
+
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_qset_wait
+ *
+ * Description:
+ *    Returns the indices of member queues that hold items,
+ *    parking on a futex until one does. Must only be called
+ *    from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    uint32_t* const ready - Array to write the indices to.
+ *    uint32_t capacity - Number of indices ready can hold.
+ *    uint32_t* const count - Number of indices written.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - No queue held items for timeout_us.
+ *    Q2_SUCCESS - count indices written.
+ *    Q2_ERROR_NULL_PARAMETER - When set, ready or count is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_wait(q2_qset_context_t* const set, uint32_t* const ready, uint32_t capacity, uint32_t* const count, uint32_t timeout_us);
+
+/**********************************************************
+ * Name:
+ *    q2_qset_eventfd
+ *
+ * Description:
+ *    Returns a non-blocking eventfd that becomes readable
+ *    whenever a member queue turns non-empty, for use with
+ *    epoll. The consumer reads the eventfd to reset it and
+ *    then calls q2_qset_poll. May be called while producers
+ *    run, but items put before it returns may not signal the
+ *    eventfd, so the consumer polls once after creating it.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *    int* const fd - Location to store the descriptor.
+ *
+ * Returns:
+ *    Q2_ERROR_ALLOCATION - The eventfd could not be created.
+ *    Q2_SUCCESS - Descriptor stored in fd.
+ *    Q2_ERROR_NULL_PARAMETER - When set or fd is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_eventfd(q2_qset_context_t* const set, int* const fd);
+
+/**********************************************************
+ * Name:
+ *    q2_qset_eventfd_close
+ *
+ * Description:
+ *    Closes the set's eventfd, if one was created. Only legal
+ *    once the producers have stopped, a running producer may
+ *    still write to the descriptor after it is closed and
+ *    its number reused.
+ *
+ * Parameters:
+ *    q2_qset_context_t* const set - Pointer to the set.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Eventfd closed.
+ *    Q2_ERROR_NULL_PARAMETER - When set is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 qset init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_qset_eventfd_close(q2_qset_context_t* const set);
+#endif
+
+#endif // Q2_QSET_H
@@ -0,0 +1,461 @@
+/**********************************************************
+ * Name:
+ *     q2_shm.c
+ *
+ * Description:
+ *     Implementation for single producer, single consumer
+ *     power of two queue shared between processes. Only
+ *     offsets are kept in the region, each process maps it
+ *     at its own address. Indices are free running.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_shm.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_shm_check
+ *
+ * Description:
+ *    Checks the parameters shared by create and attach and
+ *    clears the handle.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to clear.
+ *    const char* const name - Region name.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or name is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the name is too long.
+ *    Q2_SUCCESS - Parameters valid.
+ *********************************************************/
+static q2_return_t q2_shm_check(q2_shm_context_t* const ctx, const char* const name)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == name)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(strlen(name) >= Q2_SHM_NAME_MAX)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+    else
+    {
+        memset(ctx, 0x00, sizeof(q2_shm_context_t));
+        strcpy(ctx->name, name);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_shm_create
+ *
+ * Description:
+ *    Creates and maps a named shared memory queue. Called
+ *    by the producer process, which also owns the name.
+ *    Fails if the name already exists.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to initialize.
+ *    const char* const name - Region name, "/" prefixed.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or name is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 or the name or buffer is
+ *                                 too long.
+ *    Q2_ERROR_ALLOCATION - Region could not be created or
+ *                          mapped, see errno.
+ *    Q2_SUCCESS - Region created, handle initialized.
+ *********************************************************/
+uint32_t q2_shm_create(q2_shm_context_t* const ctx, const char* const name, uint32_t item_length, uint32_t max_length)
+{
+    q2_return_t ret = q2_shm_check(ctx, name);
+    size_t data_offset = sizeof(q2_shm_header_t);
+    size_t region_length = 0;
+    void* region = MAP_FAILED;
+    int fd = -1;
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(!((max_length & (max_length - 1)) == 0) || !max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else if(0 == item_length || (uint64_t)item_length * max_length > (uint64_t)(SIZE_MAX / 2))
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+        else
+        {
+            region_length = data_offset + ((size_t)item_length * max_length);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(-1 == fd)
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else
+        {
+            /* Truncation zero fills, so head and tail start at zero */
+            if(0 == ftruncate(fd, (off_t)region_length))
+            {
+                region = mmap(NULL, region_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+
+            if(MAP_FAILED == region)
+            {
+                shm_unlink(name);
+                ret = Q2_ERROR_ALLOCATION;
+            }
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->header = region;
+        ctx->header->version = Q2_SHM_VERSION;
+        ctx->header->item_length = item_length;
+        ctx->header->max_length = max_length;
+        ctx->header->region_length = region_length;
+        ctx->header->data_offset = data_offset;
+
+        /* Publishes the fields above to an attaching consumer */
+        atomic_store_explicit(&ctx->header->magic, Q2_SHM_MAGIC, memory_order_release);
+
+        ctx->data = (uint8_t*)region + data_offset;
+        ctx->region_length = region_length;
+        ctx->max_length = max_length;
+        ctx->item_length = item_length;
+        ctx->owner = true;
+        ctx->initialized = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_shm_attach
+ *
+ * Description:
+ *    Maps an existing named shared memory queue. Called by
+ *    the consumer process. The region's magic, version and
+ *    size must match what the caller expects.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to initialize.
+ *    const char* const name - Region name, "/" prefixed.
+ *    uint32_t item_length - Expected item size in bytes.
+ *    uint32_t max_length - Expected number of items.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or name is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the name is too long.
+ *    Q2_ERROR_ALLOCATION - Region could not be opened or
+ *                          mapped, see errno.
+ *    Q2_ERROR_NOT_INITIALIZED - Creator has not finished
+ *                               writing the header yet.
+ *    Q2_ERROR_INCOMPATIBLE - Version, item_length,
+ *                            max_length or size differ.
+ *    Q2_SUCCESS - Region attached, handle initialized.
+ *********************************************************/
+uint32_t q2_shm_attach(q2_shm_context_t* const ctx, const char* const name, uint32_t item_length, uint32_t max_length)
+{
+    q2_return_t ret = q2_shm_check(ctx, name);
+    q2_shm_header_t* header = MAP_FAILED;
+    struct stat info;
+    uint32_t magic;
+    int fd = -1;
+
+    if(Q2_SUCCESS == ret)
+    {
+        fd = shm_open(name, O_RDWR, 0);
+        if(-1 == fd || 0 != fstat(fd, &info))
+        {
+            ret = Q2_ERROR_ALLOCATION;
+        }
+        else if((size_t)info.st_size < sizeof(q2_shm_header_t))
+        {
+            /* Created but not yet sized */
+            ret = Q2_ERROR_NOT_INITIALIZED;
+        }
+        else
+        {
+            header = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(MAP_FAILED == header)
+            {
+                ret = Q2_ERROR_ALLOCATION;
+            }
+        }
+
+        if(-1 != fd)
+        {
+            close(fd);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        magic = atomic_load_explicit(&header->magic, memory_order_acquire);
+        if(0 == magic)
+        {
+            ret = Q2_ERROR_NOT_INITIALIZED;
+        }
+        else if(Q2_SHM_MAGIC != magic ||
+                Q2_SHM_VERSION != header->version ||
+                item_length != header->item_length ||
+                max_length != header->max_length ||
+                (uint64_t)info.st_size != header->region_length ||
+                sizeof(q2_shm_header_t) != header->data_offset)
+        {
+            ret = Q2_ERROR_INCOMPATIBLE;
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            ctx->header = header;
+            ctx->data = (uint8_t*)header + header->data_offset;
+            ctx->region_length = (size_t)info.st_size;
+            ctx->max_length = max_length;
+            ctx->item_length = item_length;
+            ctx->index_cache = atomic_load_explicit(&header->head, memory_order_acquire);
+            ctx->initialized = true;
+        }
+        else
+        {
+            munmap(header, (size_t)info.st_size);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_shm_detach
+ *
+ * Description:
+ *    Unmaps the region. The creator also removes the name,
+ *    an attached consumer keeps its mapping until it
+ *    detaches too.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to release.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Region detached.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_detach(q2_shm_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        munmap(ctx->header, ctx->region_length);
+        if(true == ctx->owner)
+        {
+            shm_unlink(ctx->name);
+        }
+        ctx->initialized = false;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_shm_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    Must only be called from the producer.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_put(q2_shm_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        uint32_t head = atomic_load_explicit(&ctx->header->head, memory_order_relaxed);
+
+        /* Only touch the consumer's cache line when the cached tail says full */
+        if((head - ctx->index_cache) == ctx->max_length)
+        {
+            ctx->index_cache = atomic_load_explicit(&ctx->header->tail, memory_order_acquire);
+            if((head - ctx->index_cache) == ctx->max_length)
+            {
+                ret = Q2_ERROR_FULL;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy((uint8_t*)ctx->data + ((size_t)(head & (ctx->max_length - 1)) * ctx->item_length), input, ctx->item_length);
+            atomic_store_explicit(&ctx->header->head, head + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_shm_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Must only be called from the consumer.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_get(q2_shm_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        uint32_t tail = atomic_load_explicit(&ctx->header->tail, memory_order_relaxed);
+
+        /* Only touch the producer's cache line when the cached head says empty */
+        if(ctx->index_cache == tail)
+        {
+            ctx->index_cache = atomic_load_explicit(&ctx->header->head, memory_order_acquire);
+            if(ctx->index_cache == tail)
+            {
+                ret = Q2_ERROR_EMPTY;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy(output, (uint8_t*)ctx->data + ((size_t)(tail & (ctx->max_length - 1)) * ctx->item_length), ctx->item_length);
+            atomic_store_explicit(&ctx->header->tail, tail + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_shm_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_length(q2_shm_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Tail is loaded first so it never passes head, clamp for a racing put */
+        uint32_t tail = atomic_load_explicit(&ctx->header->tail, memory_order_acquire);
+        uint32_t head = atomic_load_explicit(&ctx->header->head, memory_order_acquire);
+        *length = head - tail;
+        if(*length > ctx->max_length)
+        {
+            *length = ctx->max_length;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,212 @@
+/**********************************************************
+ * Name:
+ *     q2_shm.h
+ *
+ * Description:
+ *     Header for single producer, single consumer power of
+ *     two queue shared between processes. The header and
+ *     ring buffer live in a named POSIX shared memory
+ *     region, only the handle is process local.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_SHM_H
+#define Q2_SHM_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_SHM_MAGIC    (0x51325348)
+#define Q2_SHM_VERSION  (1)
+
+/* Longest region name including the terminator */
+#define Q2_SHM_NAME_MAX (256)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+/* Layout of the start of the shared region, data follows */
+typedef struct
+{
+    /* Written once by the creator, magic is stored last */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t item_length;
+    uint32_t max_length;
+    uint64_t region_length;
+    uint64_t data_offset;
+
+    /* Producer owned, published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+
+    /* Consumer owned, published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+} q2_shm_header_t;
+
+/* Process local handle onto the shared region */
+typedef struct
+{
+    bool initialized;
+    bool owner;
+
+    q2_shm_header_t* header;
+    void* data;
+    size_t region_length;
+    uint32_t max_length;
+    uint32_t item_length;
+
+    /* Last seen value of the other side's index */
+    uint32_t index_cache;
+
+    char name[Q2_SHM_NAME_MAX];
+} q2_shm_context_t;
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_shm_create
+ *
+ * Description:
+ *    Creates and maps a named shared memory queue. Called
+ *    by the producer process, which also owns the name.
+ *    Fails if the name already exists.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to initialize.
+ *    const char* const name - Region name, "/" prefixed.
+ *    uint32_t item_length - Size of one item in bytes.
+ *    uint32_t max_length - Number of items, power of two.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or name is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When item_length is zero,
+ *                                 or the name or buffer is
+ *                                 too long.
+ *    Q2_ERROR_ALLOCATION - Region could not be created or
+ *                          mapped, see errno.
+ *    Q2_SUCCESS - Region created, handle initialized.
+ *********************************************************/
+uint32_t q2_shm_create(q2_shm_context_t* const ctx, const char* const name, uint32_t item_length, uint32_t max_length);
+
+/**********************************************************
+ * Name:
+ *    q2_shm_attach
+ *
+ * Description:
+ *    Maps an existing named shared memory queue. Called by
+ *    the consumer process. The region's magic, version and
+ *    size must match what the caller expects.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to initialize.
+ *    const char* const name - Region name, "/" prefixed.
+ *    uint32_t item_length - Expected item size in bytes.
+ *    uint32_t max_length - Expected number of items.
+ *
+ * Returns:
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or name is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the name is too long.
+ *    Q2_ERROR_ALLOCATION - Region could not be opened or
+ *                          mapped, see errno.
+ *    Q2_ERROR_NOT_INITIALIZED - Creator has not finished
+ *                               writing the header yet.
+ *    Q2_ERROR_INCOMPATIBLE - Version, item_length,
+ *                            max_length or size differ.
+ *    Q2_SUCCESS - Region attached, handle initialized.
+ *********************************************************/
+uint32_t q2_shm_attach(q2_shm_context_t* const ctx, const char* const name, uint32_t item_length, uint32_t max_length);
+
+/**********************************************************
+ * Name:
+ *    q2_shm_detach
+ *
+ * Description:
+ *    Unmaps the region. The creator also removes the name,
+ *    an attached consumer keeps its mapping until it
+ *    detaches too.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Handle to release.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Region detached.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_detach(q2_shm_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_shm_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    Must only be called from the producer.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_put(q2_shm_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_shm_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Must only be called from the consumer.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_get(q2_shm_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_shm_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_shm_context_t* const ctx - Pointer to the handle.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When not created or
+ *                               attached.
+ *********************************************************/
+uint32_t q2_shm_length(q2_shm_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_SHM_H
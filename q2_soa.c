@@ -0,0 +1,478 @@
+/**********************************************************
+ * Name:
+ *     q2_soa.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer, single
+ *     consumer structure-of-arrays queue. Head and tail are
+ *     free running and shared by every column, the slot
+ *     index is taken by masking.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_soa.h"
+#include <string.h>
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_SOA_ROUND_UP(value, multiple) ((((value) + (multiple) - 1) / (multiple)) * (multiple))
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_soa_scatter
+ *
+ * Description:
+ *    Copies the fields of count records into their columns
+ *    starting at slot, one column at a time. Caller must
+ *    ensure the slots do not run past the end of the buffer.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    const uint8_t* input - First record to copy.
+ *    uint32_t slot - First column slot to fill.
+ *    uint32_t count - Number of records.
+ *********************************************************/
+static void q2_soa_scatter(q2_soa_context_t* const ctx, const uint8_t* input, uint32_t slot, uint32_t count)
+{
+    const q2_soa_field_t* field;
+    uint8_t* column;
+    uint32_t c;
+    uint32_t i;
+
+    for(c = 0; c < ctx->column_count; c++)
+    {
+        field = &ctx->fields[c];
+        column = ctx->columns[c] + ((size_t)slot * field->length);
+        for(i = 0; i < count; i++)
+        {
+            memcpy(column + ((size_t)i * field->length), input + ((size_t)i * ctx->record_length) + field->offset, field->length);
+        }
+    }
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_soa_init
+ *
+ * Description:
+ *    Initializes the context and carves one column per
+ *    field out of the storage, each cache line aligned.
+ *    Must be called before the producer and consumer
+ *    threads are started.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are no columns
+ *                                 or more than
+ *                                 Q2_SOA_MAX_COLUMNS, a field
+ *                                 lies outside the record, or
+ *                                 the columns do not fit the
+ *                                 storage.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_soa_init(q2_soa_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_soa_field_t* field;
+    uint64_t offset = 0;
+    uint64_t column_length;
+    uint32_t c;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+    {
+        ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+    }
+    else if(0 == ctx->column_count || ctx->column_count > Q2_SOA_MAX_COLUMNS)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    for(c = 0; Q2_SUCCESS == ret && c < ctx->column_count; c++)
+    {
+        field = &ctx->fields[c];
+        column_length = (uint64_t)field->length * ctx->max_length;
+        if(0 == field->length || ((uint64_t)field->offset + field->length) > ctx->record_length ||
+           (offset + column_length) > ctx->data_length)
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+        else
+        {
+            ctx->columns[c] = (uint8_t*)ctx->data + offset;
+            offset += Q2_SOA_ROUND_UP(column_length, Q2_CACHE_LINE_SIZE);
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ctx->tail, 0, memory_order_relaxed);
+        ctx->initialized = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_put
+ *
+ * Description:
+ *    Splits a record into its columns and updates the head
+ *    index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const input - Record to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added record to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_put(q2_soa_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        if((head - atomic_load_explicit(&ctx->tail, memory_order_acquire)) == ctx->max_length)
+        {
+            ret = Q2_ERROR_FULL;
+        }
+        else
+        {
+            q2_soa_scatter(ctx, input, Q2_INDEX(ctx, head), 1);
+            atomic_store_explicit(&ctx->head, head + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_put_n
+ *
+ * Description:
+ *    Splits up to count records into their columns, one
+ *    column at a time, and publishes them with a single
+ *    head update.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const input - Array of records to be put in the
+ *                        queue.
+ *    uint32_t count - Number of records in input.
+ *    uint32_t* const transferred - Number of records added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No records could be added.
+ *    Q2_SUCCESS - Successfully added transferred records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_put_n(q2_soa_context_t* const ctx, void* const input, uint32_t count, uint32_t* const transferred)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+    uint32_t available;
+    uint32_t first;
+
+    if(NULL == ctx || NULL == input || NULL == transferred)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        available = ctx->max_length - (head - atomic_load_explicit(&ctx->tail, memory_order_acquire));
+        if(count > available)
+        {
+            count = available;
+            if(0 == count)
+            {
+                ret = Q2_ERROR_FULL;
+            }
+        }
+
+        /* Split the copy at the end of the buffer */
+        first = ctx->max_length - Q2_INDEX(ctx, head);
+        if(first > count)
+        {
+            first = count;
+        }
+        q2_soa_scatter(ctx, input, Q2_INDEX(ctx, head), first);
+        q2_soa_scatter(ctx, (uint8_t*)input + ((size_t)first * ctx->record_length), 0, count - first);
+        atomic_store_explicit(&ctx->head, head + count, memory_order_release);
+
+        *transferred = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_get
+ *
+ * Description:
+ *    Gathers the oldest record back from its columns and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to build the record in.
+ *                         Bytes outside the fields are left
+ *                         untouched.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved record.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_get(q2_soa_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    const q2_soa_field_t* field;
+    uint32_t tail;
+    uint32_t slot;
+    uint32_t c;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+        if(atomic_load_explicit(&ctx->head, memory_order_acquire) == tail)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        else
+        {
+            slot = Q2_INDEX(ctx, tail);
+            for(c = 0; c < ctx->column_count; c++)
+            {
+                field = &ctx->fields[c];
+                memcpy((uint8_t*)output + field->offset, ctx->columns[c] + ((size_t)slot * field->length), field->length);
+            }
+            atomic_store_explicit(&ctx->tail, tail + 1, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_peek
+ *
+ * Description:
+ *    Returns a pointer into every column at the oldest
+ *    queued record, so the consumer can loop over the
+ *    fields in place. The spans stop at the end of the
+ *    buffer. Records stay queued until q2_soa_release is
+ *    called.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t count - Number of records wanted.
+ *    void** const spans - Set to the start of each column's
+ *                         span, one entry per column.
+ *    uint32_t* const available - Number of contiguous records
+ *                                in every span, at most
+ *                                count.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully peeked records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, spans or available
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_peek(q2_soa_context_t* const ctx, uint32_t count, void** const spans, uint32_t* const available)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t slot;
+    uint32_t c;
+
+    if(NULL == ctx || NULL == spans || NULL == available)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+        used = atomic_load_explicit(&ctx->head, memory_order_acquire) - tail;
+        if(0 == used)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+
+        /* Stop the spans at the end of the buffer */
+        slot = Q2_INDEX(ctx, tail);
+        if(used > (ctx->max_length - slot))
+        {
+            used = ctx->max_length - slot;
+        }
+        if(count > used)
+        {
+            count = used;
+        }
+
+        for(c = 0; c < ctx->column_count; c++)
+        {
+            spans[c] = ctx->columns[c] + ((size_t)slot * ctx->fields[c].length);
+        }
+        *available = count;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_release
+ *
+ * Description:
+ *    Frees count records processed through q2_soa_peek and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t count - Number of records processed.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Fewer than count records are queued.
+ *    Q2_SUCCESS - Successfully released records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_release(q2_soa_context_t* const ctx, uint32_t count)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+        if(count > (atomic_load_explicit(&ctx->head, memory_order_acquire) - tail))
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        else
+        {
+            atomic_store_explicit(&ctx->tail, tail + count, memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_soa_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_length(q2_soa_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Tail first, so the length never goes negative */
+        tail = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+        *length = atomic_load_explicit(&ctx->head, memory_order_acquire) - tail;
+    }
+
+    return ret;
+}
@@ -0,0 +1,258 @@
+/**********************************************************
+ * Name:
+ *     q2_soa.h
+ *
+ * Description:
+ *     Header for lock-free single producer, single consumer
+ *     structure-of-arrays queue. Records are put whole and
+ *     split into one power of two column per field, all
+ *     sharing one head and tail, so a consumer can run over
+ *     contiguous spans of just the fields it needs.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_SOA_H
+#define Q2_SOA_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_SOA_MAX_COLUMNS (32)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+/* Where a column's field sits in the record */
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+} q2_soa_field_t;
+
+typedef struct
+{
+    /* Producer owned, head is published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+
+    /* Consumer owned, tail is published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    const q2_soa_field_t* fields;
+    uint8_t** columns;
+    uint32_t column_count;
+
+    /* Storage the columns are carved from, each starts on a cache line */
+    void* data;
+    uint32_t data_length;
+    uint32_t max_length;
+    uint32_t record_length;
+} q2_soa_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_SOA_FIELD(struct_type, member) \
+        { .offset = offsetof(struct_type, member), .length = sizeof(((struct_type*)0)->member) }
+
+/* Storage for queue_size records split over columns_size columns */
+#define Q2_SOA_DATA_LENGTH(struct_type, queue_size, columns_size) \
+        (((queue_size) * sizeof(struct_type)) + ((columns_size) * Q2_CACHE_LINE_SIZE))
+
+#define Q2_SOA(context_name, struct_type, queue_size, ...) \
+        static const q2_soa_field_t context_name##_fields[] = { __VA_ARGS__ }; \
+        static uint8_t* context_name##_columns[sizeof(context_name##_fields) / sizeof(q2_soa_field_t)]; \
+        static _Alignas(Q2_CACHE_LINE_SIZE) uint8_t context_name##_array[Q2_SOA_DATA_LENGTH(struct_type, queue_size, sizeof(context_name##_fields) / sizeof(q2_soa_field_t))]; \
+        static q2_soa_context_t context_name = { \
+            .head = 0, \
+            .tail = 0, \
+            .initialized = false, \
+            .fields = context_name##_fields, \
+            .columns = context_name##_columns, \
+            .column_count = sizeof(context_name##_fields) / sizeof(q2_soa_field_t), \
+            .data = context_name##_array, \
+            .data_length = sizeof(context_name##_array), \
+            .max_length = queue_size, \
+            .record_length = sizeof(struct_type) \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_soa_init
+ *
+ * Description:
+ *    Initializes the context and carves one column per
+ *    field out of the storage, each cache line aligned.
+ *    Must be called before the producer and consumer
+ *    threads are started.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When there are no columns
+ *                                 or more than
+ *                                 Q2_SOA_MAX_COLUMNS, a field
+ *                                 lies outside the record, or
+ *                                 the columns do not fit the
+ *                                 storage.
+ *    Q2_SUCCESS - Context initialized.
+ *********************************************************/
+uint32_t q2_soa_init(q2_soa_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_put
+ *
+ * Description:
+ *    Splits a record into its columns and updates the head
+ *    index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const input - Record to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added record to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_put(q2_soa_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_put_n
+ *
+ * Description:
+ *    Splits up to count records into their columns, one
+ *    column at a time, and publishes them with a single
+ *    head update.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const input - Array of records to be put in the
+ *                        queue.
+ *    uint32_t count - Number of records in input.
+ *    uint32_t* const transferred - Number of records added.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - No records could be added.
+ *    Q2_SUCCESS - Successfully added transferred records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, input or
+ *                              transferred is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_put_n(q2_soa_context_t* const ctx, void* const input, uint32_t count, uint32_t* const transferred);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_get
+ *
+ * Description:
+ *    Gathers the oldest record back from its columns and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to build the record in.
+ *                         Bytes outside the fields are left
+ *                         untouched.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved record.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_get(q2_soa_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_peek
+ *
+ * Description:
+ *    Returns a pointer into every column at the oldest
+ *    queued record, so the consumer can loop over the
+ *    fields in place. The spans stop at the end of the
+ *    buffer. Records stay queued until q2_soa_release is
+ *    called.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t count - Number of records wanted.
+ *    void** const spans - Set to the start of each column's
+ *                         span, one entry per column.
+ *    uint32_t* const available - Number of contiguous records
+ *                                in every span, at most
+ *                                count.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully peeked records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, spans or available
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_peek(q2_soa_context_t* const ctx, uint32_t count, void** const spans, uint32_t* const available);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_release
+ *
+ * Description:
+ *    Frees count records processed through q2_soa_peek and
+ *    updates the tail index.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t count - Number of records processed.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Fewer than count records are queued.
+ *    Q2_SUCCESS - Successfully released records.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_release(q2_soa_context_t* const ctx, uint32_t count);
+
+/**********************************************************
+ * Name:
+ *    q2_soa_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_soa_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 soa init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_soa_length(q2_soa_context_t* const ctx, uint32_t* const length);
+
+#endif // Q2_SOA_H
@@ -0,0 +1,860 @@
+/**********************************************************
+ * Name:
+ *     q2_spsc.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer, single
+ *     consumer power of two queue. Head and tail are free
+ *     running, the slot index is taken by masking.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#define _GNU_SOURCE
+#include "q2_spsc.h"
+#include "q2_qset.h"
+#include <string.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_SPSC_SPIN_MIN (16)
+#define Q2_SPSC_SPIN_MAX (4096)
+
+/* Watermark states, a side only acts once the other side's handler has returned */
+#define Q2_SPSC_WATERMARK_LOW     (0)
+#define Q2_SPSC_WATERMARK_HIGH    (1)
+#define Q2_SPSC_WATERMARK_RISING  (2)
+#define Q2_SPSC_WATERMARK_FALLING (3)
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_spsc_deadline
+ *
+ * Description:
+ *    Returns the monotonic time in nanoseconds at which a
+ *    wait of timeout_us expires.
+ *
+ * Parameters:
+ *    uint32_t timeout_us - Timeout in microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Deadline in nanoseconds, UINT64_MAX for no deadline.
+ *********************************************************/
+static uint64_t q2_spsc_deadline(uint32_t timeout_us)
+{
+    struct timespec now;
+    uint64_t deadline = UINT64_MAX;
+
+    if(Q2_WAIT_FOREVER != timeout_us)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        deadline = ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec + ((uint64_t)timeout_us * 1000ull);
+    }
+
+    return deadline;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_park
+ *
+ * Description:
+ *    Flags this side as waiting and sleeps on the futex
+ *    word while it still holds blocked_value. The flag is
+ *    set before the word is re-checked so a wake from the
+ *    other side cannot be missed.
+ *
+ * Parameters:
+ *    _Atomic uint32_t* const waiting - This side's flag.
+ *    _Atomic uint32_t* const word - Index to sleep on.
+ *    uint32_t blocked_value - Value of word while blocked.
+ *    uint64_t deadline - Deadline from q2_spsc_deadline.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Deadline has passed.
+ *    Q2_SUCCESS - Woken, or word changed before sleeping.
+ *********************************************************/
+static q2_return_t q2_spsc_park(_Atomic uint32_t* const waiting, _Atomic uint32_t* const word, uint32_t blocked_value, uint64_t deadline)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    struct timespec now;
+    struct timespec timeout;
+    struct timespec* timeout_ptr = NULL;
+    uint64_t now_ns;
+
+    if(UINT64_MAX != deadline)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now_ns = ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+        if(now_ns >= deadline)
+        {
+            ret = Q2_ERROR_TIMEOUT;
+        }
+        else
+        {
+            timeout.tv_sec = (time_t)((deadline - now_ns) / 1000000000ull);
+            timeout.tv_nsec = (long)((deadline - now_ns) % 1000000000ull);
+            timeout_ptr = &timeout;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        atomic_store_explicit(waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        /* Not private, so queues in shared memory can be waited on too */
+        if(blocked_value == atomic_load_explicit(word, memory_order_relaxed) &&
+           -1 == syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, blocked_value, timeout_ptr, NULL, 0) &&
+           ETIMEDOUT == errno)
+        {
+            ret = Q2_ERROR_TIMEOUT;
+        }
+
+        atomic_store_explicit(waiting, 0, memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_wake
+ *
+ * Description:
+ *    Wakes the other side if it is parked on the futex
+ *    word. Only makes a syscall when the waiting flag is set.
+ *
+ * Parameters:
+ *    _Atomic uint32_t* const waiting - Other side's flag.
+ *    _Atomic uint32_t* const word - Index it sleeps on.
+ *********************************************************/
+static void q2_spsc_wake(_Atomic uint32_t* const waiting, _Atomic uint32_t* const word)
+{
+    /* Pairs with the fence in q2_spsc_park */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(0 != atomic_load_explicit(waiting, memory_order_relaxed))
+    {
+        syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_adapt_spin
+ *
+ * Description:
+ *    Doubles the spin budget when spinning paid off and
+ *    halves it when the caller had to park anyway.
+ *
+ * Parameters:
+ *    uint32_t* const spin - Spin budget to adjust.
+ *    bool spin_succeeded - Whether spinning avoided a park.
+ *********************************************************/
+static void q2_spsc_adapt_spin(uint32_t* const spin, bool spin_succeeded)
+{
+    if(true == spin_succeeded)
+    {
+        if(*spin < Q2_SPSC_SPIN_MAX)
+        {
+            *spin *= 2;
+        }
+    }
+    else if(*spin > Q2_SPSC_SPIN_MIN)
+    {
+        *spin /= 2;
+    }
+}
+#endif
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_watermark_high
+ *
+ * Description:
+ *    Signals the high watermark if the queue holds at least
+ *    high items and the last low signal has returned. The
+ *    cached tail only overstates occupancy, so the real tail
+ *    is loaded before signalling. The state stays rising
+ *    while the handler runs, so the consumer cannot signal
+ *    low until it returns. Producer side.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t head - Head index after the put.
+ *********************************************************/
+static void q2_spsc_watermark_high(q2_spsc_context_t* const ctx, uint32_t head)
+{
+    uint32_t expected = Q2_SPSC_WATERMARK_LOW;
+
+    if(NULL != ctx->watermark_handler && (head - ctx->tail_cache) >= ctx->high_watermark &&
+       Q2_SPSC_WATERMARK_LOW == atomic_load_explicit(&ctx->watermark_crossed, memory_order_relaxed))
+    {
+        ctx->tail_cache = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+        if((head - ctx->tail_cache) >= ctx->high_watermark &&
+           true == atomic_compare_exchange_strong_explicit(&ctx->watermark_crossed, &expected, Q2_SPSC_WATERMARK_RISING, memory_order_acquire, memory_order_relaxed))
+        {
+            ctx->watermark_handler(true, ctx->watermark_arg);
+            atomic_store_explicit(&ctx->watermark_crossed, Q2_SPSC_WATERMARK_HIGH, memory_order_release);
+        }
+    }
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_watermark_low
+ *
+ * Description:
+ *    Signals the low watermark if the queue holds at most
+ *    low items and the last high signal has returned. The
+ *    cached head only understates occupancy, so the real
+ *    head is loaded before signalling. The state stays
+ *    falling while the handler runs, so the producer cannot
+ *    signal high until it returns. Consumer side.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t tail - Tail index after the get.
+ *********************************************************/
+static void q2_spsc_watermark_low(q2_spsc_context_t* const ctx, uint32_t tail)
+{
+    uint32_t expected = Q2_SPSC_WATERMARK_HIGH;
+
+    if(NULL != ctx->watermark_handler && (ctx->head_cache - tail) <= ctx->low_watermark &&
+       Q2_SPSC_WATERMARK_HIGH == atomic_load_explicit(&ctx->watermark_crossed, memory_order_relaxed))
+    {
+        ctx->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        if((ctx->head_cache - tail) <= ctx->low_watermark &&
+           true == atomic_compare_exchange_strong_explicit(&ctx->watermark_crossed, &expected, Q2_SPSC_WATERMARK_FALLING, memory_order_acquire, memory_order_relaxed))
+        {
+            ctx->watermark_handler(false, ctx->watermark_arg);
+            atomic_store_explicit(&ctx->watermark_crossed, Q2_SPSC_WATERMARK_LOW, memory_order_release);
+        }
+    }
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_spsc_init
+ *
+ * Description:
+ *    Initializes the spsc context. Checks that the queue
+ *    length is a power of two, removes the queue from any
+ *    queue set and turns watermarks and waiting off. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_spsc_init(q2_spsc_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Check for power of two */
+        if(!((ctx->max_length & (ctx->max_length - 1)) == 0) || !ctx->max_length)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else
+        {
+            atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->tail, 0, memory_order_relaxed);
+            ctx->tail_cache = 0;
+            ctx->head_cache = 0;
+            ctx->producer_spin = Q2_SPSC_SPIN_MIN;
+            ctx->consumer_spin = Q2_SPSC_SPIN_MIN;
+            atomic_store_explicit(&ctx->producer_waiting, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->consumer_waiting, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->watermark_crossed, Q2_SPSC_WATERMARK_LOW, memory_order_relaxed);
+            ctx->qset = NULL;
+            ctx->qset_index = 0;
+            ctx->high_watermark = 0;
+            ctx->low_watermark = 0;
+            ctx->watermark_handler = NULL;
+            ctx->watermark_arg = NULL;
+            ctx->wait_enabled = false;
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    Signals the queue set, if any, after every put, which
+ *    costs a full fence even when the ready bit is already
+ *    set. Wakes a parked consumer when waiting is enabled.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_put(q2_spsc_context_t* const ctx, void* const input)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        uint32_t head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+
+        /* Only touch the consumer's cache line when the cached tail says full */
+        if((head - ctx->tail_cache) == ctx->max_length)
+        {
+            ctx->tail_cache = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+            if((head - ctx->tail_cache) == ctx->max_length)
+            {
+                ret = Q2_ERROR_FULL;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy((uint8_t*)ctx->data + ((head & (ctx->max_length - 1)) * ctx->item_length), input, ctx->item_length);
+            atomic_store_explicit(&ctx->head, head + 1, memory_order_release);
+
+            if(NULL != ctx->qset)
+            {
+                q2_qset_signal(ctx->qset, ctx->qset_index);
+            }
+#if defined(__linux__)
+            if(true == ctx->wait_enabled)
+            {
+                q2_spsc_wake(&ctx->consumer_waiting, &ctx->head);
+            }
+#endif
+        }
+
+        q2_spsc_watermark_high(ctx, atomic_load_explicit(&ctx->head, memory_order_relaxed));
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Wakes a parked producer when waiting is enabled.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_get(q2_spsc_context_t* const ctx, void* const output)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        uint32_t tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+
+        /* Only touch the producer's cache line when the cached head says empty */
+        if(ctx->head_cache == tail)
+        {
+            ctx->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+            if(ctx->head_cache == tail)
+            {
+                ret = Q2_ERROR_EMPTY;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            memcpy(output, (uint8_t*)ctx->data + ((tail & (ctx->max_length - 1)) * ctx->item_length), ctx->item_length);
+            atomic_store_explicit(&ctx->tail, tail + 1, memory_order_release);
+#if defined(__linux__)
+            if(true == ctx->wait_enabled)
+            {
+                q2_spsc_wake(&ctx->producer_waiting, &ctx->tail);
+            }
+#endif
+        }
+
+        q2_spsc_watermark_low(ctx, atomic_load_explicit(&ctx->tail, memory_order_relaxed));
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_length(q2_spsc_context_t* const ctx, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Tail is loaded first so it never passes head, clamp for a racing put */
+        uint32_t tail = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+        uint32_t head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        *length = head - tail;
+        if(*length > ctx->max_length)
+        {
+            *length = ctx->max_length;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_drain
+ *
+ * Description:
+ *    Calls handler on each queued item in place, oldest
+ *    first, without copying it out. Stops after max_items
+ *    items or max_bytes bytes, or after the handler returns
+ *    false. The head is loaded and the tail is published
+ *    once for the whole batch, and a parked producer is woken
+ *    once when waiting is enabled. The item pointer is only
+ *    valid during the call. Must only be called from the
+ *    consumer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_drain(q2_spsc_context_t* const ctx, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+    uint32_t count;
+    uint32_t i = 0;
+    bool more = true;
+
+    if(NULL == ctx || NULL == handler || NULL == drained)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+        ctx->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        count = ctx->head_cache - tail;
+        if(0 == count)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+        if(count > max_items)
+        {
+            count = max_items;
+        }
+        if(Q2_NO_LIMIT != max_bytes && count > (max_bytes / ctx->item_length))
+        {
+            count = max_bytes / ctx->item_length;
+        }
+
+        while(i < count && true == more)
+        {
+            more = handler((uint8_t*)ctx->data + (((tail + i) & (ctx->max_length - 1)) * ctx->item_length), arg);
+            i++;
+        }
+
+        /* One release for the batch, the producer sees every slot freed at once */
+        if(0 != i)
+        {
+            atomic_store_explicit(&ctx->tail, tail + i, memory_order_release);
+#if defined(__linux__)
+            if(true == ctx->wait_enabled)
+            {
+                q2_spsc_wake(&ctx->producer_waiting, &ctx->tail);
+            }
+#endif
+        }
+
+        *drained = i;
+
+        q2_spsc_watermark_low(ctx, tail + i);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_watermark
+ *
+ * Description:
+ *    Sets the occupancy watermarks. The producer calls
+ *    handler with high true when a put finds high or more
+ *    items queued. The consumer calls it with high false
+ *    when a get or drain, including one on an empty queue,
+ *    finds low or fewer. The two alternate and never run at
+ *    once, so occupancy moving between the marks signals
+ *    nothing. The handlers
+ *    run on the producer and consumer threads and must not
+ *    block. A NULL handler turns watermarks off. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t high - Occupancy that signals high.
+ *    uint32_t low - Occupancy that signals low, below high.
+ *    q2_spsc_watermark_handler_t handler - Called on each
+ *                                          crossing, or
+ *                                          NULL.
+ *    void* const arg - Passed through to handler.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Watermarks set.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When high is zero or above
+ *                                 the queue length, or low
+ *                                 is not below high.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_watermark(q2_spsc_context_t* const ctx, uint32_t high, uint32_t low, q2_spsc_watermark_handler_t handler, void* const arg)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(NULL != handler && (0 == high || high > ctx->max_length || low >= high))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->high_watermark = high;
+        ctx->low_watermark = low;
+        ctx->watermark_handler = handler;
+        ctx->watermark_arg = arg;
+        atomic_store_explicit(&ctx->watermark_crossed, Q2_SPSC_WATERMARK_LOW, memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_spsc_wait_enable
+ *
+ * Description:
+ *    Allows q2_spsc_put_wait and q2_spsc_get_wait on the
+ *    queue. From then on every successful put, get and drain,
+ *    waiting or not, checks for a parked peer and wakes it,
+ *    so the two sides may mix the plain and waiting calls.
+ *    The check costs one seq_cst fence per operation, about
+ *    10 ns uncontended. Queues that never wait do not pay it.
+ *    Must be called before the producer and consumer
+ *    threads are started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Waiting enabled.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_wait_enable(q2_spsc_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ctx->wait_enabled = true;
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_put_wait
+ *
+ * Description:
+ *    Adds an item to the queue, waiting for space if the
+ *    queue is full. Spins briefly, then parks on a futex
+ *    until the consumer frees a slot. Wakes a parked
+ *    consumer. Must only be called from the producer thread.
+ *    The wake check costs one seq_cst fence per put, about
+ *    10 ns uncontended, see q2 spsc wait enable.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Queue stayed full for timeout_us.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init or q2 spsc
+ *                               wait enable has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_spsc_put_wait(q2_spsc_context_t* const ctx, void* const input, uint32_t timeout_us)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint64_t deadline;
+    uint32_t head;
+    uint32_t spin;
+
+    if(NULL == ctx || NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->wait_enabled)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else
+    {
+        ret = q2_spsc_put(ctx, input);
+    }
+
+    if(Q2_ERROR_FULL == ret)
+    {
+        deadline = q2_spsc_deadline(timeout_us);
+
+        for(spin = 0; spin < ctx->producer_spin && Q2_ERROR_FULL == ret; spin++)
+        {
+            Q2_CPU_RELAX();
+            ret = q2_spsc_put(ctx, input);
+        }
+        q2_spsc_adapt_spin(&ctx->producer_spin, Q2_SUCCESS == ret);
+
+        while(Q2_ERROR_FULL == ret)
+        {
+            /* Full while tail is still one lap behind head */
+            head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+            if(Q2_ERROR_TIMEOUT == q2_spsc_park(&ctx->producer_waiting, &ctx->tail, head - ctx->max_length, deadline))
+            {
+                ret = q2_spsc_put(ctx, input);
+                if(Q2_ERROR_FULL == ret)
+                {
+                    ret = Q2_ERROR_TIMEOUT;
+                }
+            }
+            else
+            {
+                ret = q2_spsc_put(ctx, input);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_get_wait
+ *
+ * Description:
+ *    Gets an item from the queue, waiting for one if the
+ *    queue is empty. Spins briefly, then parks on a futex
+ *    until the producer adds an item. Wakes a parked
+ *    producer. Must only be called from the consumer
+ *    thread. The wake check costs one seq_cst fence per get,
+ *    about 10 ns uncontended, see q2 spsc wait enable.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Queue stayed empty for timeout_us.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init or q2 spsc
+ *                               wait enable has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_spsc_get_wait(q2_spsc_context_t* const ctx, void* const output, uint32_t timeout_us)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint64_t deadline;
+    uint32_t tail;
+    uint32_t spin;
+
+    if(NULL == ctx || NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->wait_enabled)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else
+    {
+        ret = q2_spsc_get(ctx, output);
+    }
+
+    if(Q2_ERROR_EMPTY == ret)
+    {
+        deadline = q2_spsc_deadline(timeout_us);
+
+        for(spin = 0; spin < ctx->consumer_spin && Q2_ERROR_EMPTY == ret; spin++)
+        {
+            Q2_CPU_RELAX();
+            ret = q2_spsc_get(ctx, output);
+        }
+        q2_spsc_adapt_spin(&ctx->consumer_spin, Q2_SUCCESS == ret);
+
+        while(Q2_ERROR_EMPTY == ret)
+        {
+            /* Empty while head still equals tail */
+            tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+            if(Q2_ERROR_TIMEOUT == q2_spsc_park(&ctx->consumer_waiting, &ctx->head, tail, deadline))
+            {
+                ret = q2_spsc_get(ctx, output);
+                if(Q2_ERROR_EMPTY == ret)
+                {
+                    ret = Q2_ERROR_TIMEOUT;
+                }
+            }
+            else
+            {
+                ret = q2_spsc_get(ctx, output);
+            }
+        }
+    }
+
+    return ret;
+}
+#endif
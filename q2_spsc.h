@@ -0,0 +1,340 @@
+/**********************************************************
+ * Name:
+ *     q2_spsc.h
+ *
+ * Description:
+ *     Header for lock-free single producer, single consumer
+ *     power of two queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_SPSC_H
+#define Q2_SPSC_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+struct q2_qset_context;
+
+/* Watermark callback, high is true above the high mark and false below the low mark */
+typedef void (*q2_spsc_watermark_handler_t)(bool high, void* const arg);
+
+typedef struct
+{
+    /* Producer owned, head is published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+    uint32_t tail_cache;
+    uint32_t producer_spin;
+
+    /* Consumer owned, tail is published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+    uint32_t head_cache;
+    uint32_t consumer_spin;
+
+    /* Set only around parking or on a watermark crossing, so the other side's reads stay cached */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t producer_waiting;
+    _Atomic uint32_t consumer_waiting;
+    _Atomic uint32_t watermark_crossed;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    void* data;
+    uint32_t max_length;
+    uint32_t item_length;
+
+    /* Queue set signalled on every put, see q2_qset.h */
+    struct q2_qset_context* qset;
+    uint32_t qset_index;
+
+    /* Occupancy watermarks, see q2 spsc watermark. A NULL handler disables them */
+    uint32_t high_watermark;
+    uint32_t low_watermark;
+    q2_spsc_watermark_handler_t watermark_handler;
+    void* watermark_arg;
+
+    /* Set by q2 spsc wait enable, every put and get then wakes a parked peer */
+    bool wait_enabled;
+} q2_spsc_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_SPSC(context_name, struct_type, queue_size) \
+        static struct_type context_name##_array[queue_size]; \
+        static q2_spsc_context_t context_name = { \
+            .head = 0, \
+            .tail_cache = 0, \
+            .producer_spin = 0, \
+            .tail = 0, \
+            .head_cache = 0, \
+            .consumer_spin = 0, \
+            .producer_waiting = 0, \
+            .consumer_waiting = 0, \
+            .watermark_crossed = 0, \
+            .initialized = false, \
+            .data = context_name##_array, \
+            .max_length = queue_size, \
+            .item_length = sizeof(struct_type), \
+            .qset = NULL, \
+            .qset_index = 0, \
+            .high_watermark = 0, \
+            .low_watermark = 0, \
+            .watermark_handler = NULL, \
+            .watermark_arg = NULL, \
+            .wait_enabled = false \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_spsc_init
+ *
+ * Description:
+ *    Initializes the spsc context. Checks that the queue
+ *    length is a power of two, removes the queue from any
+ *    queue set and turns watermarks and waiting off. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_spsc_init(q2_spsc_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_put
+ *
+ * Description:
+ *    Adds an item to the queue and publishes the head index.
+ *    Signals the queue set, if any, after every put, which
+ *    costs a full fence even when the ready bit is already
+ *    set. Wakes a parked consumer when waiting is enabled.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Queue is full.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_put(q2_spsc_context_t* const ctx, void* const input);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_get
+ *
+ * Description:
+ *    Gets an item from the queue and publishes the tail
+ *    index. Wakes a parked producer when waiting is enabled.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_get(q2_spsc_context_t* const ctx, void* const output);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_length
+ *
+ * Description:
+ *    Returns the current length of the queue. The value is
+ *    a snapshot and may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const length - Current length of queue.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved length.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or length is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_length(q2_spsc_context_t* const ctx, uint32_t* const length);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_drain
+ *
+ * Description:
+ *    Calls handler on each queued item in place, oldest
+ *    first, without copying it out. Stops after max_items
+ *    items or max_bytes bytes, or after the handler returns
+ *    false. The head is loaded and the tail is published
+ *    once for the whole batch, and a parked producer is woken
+ *    once when waiting is enabled. The item pointer is only
+ *    valid during the call. Must only be called from the
+ *    consumer thread.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    q2_drain_handler_t handler - Called for each item.
+ *    void* const arg - Passed through to handler.
+ *    uint32_t max_items - Item limit, or Q2_NO_LIMIT.
+ *    uint32_t max_bytes - Byte limit, or Q2_NO_LIMIT.
+ *    uint32_t* const drained - Number of items handled.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully drained items, possibly none
+ *                 if the limits are smaller than one item.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, handler or drained
+ *                              is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_drain(q2_spsc_context_t* const ctx, q2_drain_handler_t handler, void* const arg, uint32_t max_items, uint32_t max_bytes, uint32_t* const drained);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_watermark
+ *
+ * Description:
+ *    Sets the occupancy watermarks. The producer calls
+ *    handler with high true when a put finds high or more
+ *    items queued. The consumer calls it with high false
+ *    when a get or drain, including one on an empty queue,
+ *    finds low or fewer. The two alternate and never run at
+ *    once, so occupancy moving between the marks signals
+ *    nothing. The handlers
+ *    run on the producer and consumer threads and must not
+ *    block. A NULL handler turns watermarks off. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    uint32_t high - Occupancy that signals high.
+ *    uint32_t low - Occupancy that signals low, below high.
+ *    q2_spsc_watermark_handler_t handler - Called on each
+ *                                          crossing, or
+ *                                          NULL.
+ *    void* const arg - Passed through to handler.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Watermarks set.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When high is zero or above
+ *                                 the queue length, or low
+ *                                 is not below high.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_watermark(q2_spsc_context_t* const ctx, uint32_t high, uint32_t low, q2_spsc_watermark_handler_t handler, void* const arg);
+
+#if defined(__linux__)
+/**********************************************************
+ * Name:
+ *    q2_spsc_wait_enable
+ *
+ * Description:
+ *    Allows q2_spsc_put_wait and q2_spsc_get_wait on the
+ *    queue. From then on every successful put, get and drain,
+ *    waiting or not, checks for a parked peer and wakes it,
+ *    so the two sides may mix the plain and waiting calls.
+ *    The check costs one seq_cst fence per operation, about
+ *    10 ns uncontended. Queues that never wait do not pay it.
+ *    Must be called before the producer and consumer
+ *    threads are started.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Waiting enabled.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_spsc_wait_enable(q2_spsc_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_put_wait
+ *
+ * Description:
+ *    Adds an item to the queue, waiting for space if the
+ *    queue is full. Spins briefly, then parks on a futex
+ *    until the consumer frees a slot. Wakes a parked
+ *    consumer. Must only be called from the producer thread.
+ *    The wake check costs one seq_cst fence per put, about
+ *    10 ns uncontended, see q2 spsc wait enable.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const input - Item to be put in the queue.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Queue stayed full for timeout_us.
+ *    Q2_SUCCESS - Successfully added item to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init or q2 spsc
+ *                               wait enable has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_spsc_put_wait(q2_spsc_context_t* const ctx, void* const input, uint32_t timeout_us);
+
+/**********************************************************
+ * Name:
+ *    q2_spsc_get_wait
+ *
+ * Description:
+ *    Gets an item from the queue, waiting for one if the
+ *    queue is empty. Spins briefly, then parks on a futex
+ *    until the producer adds an item. Wakes a parked
+ *    producer. Must only be called from the consumer
+ *    thread. The wake check costs one seq_cst fence per get,
+ *    about 10 ns uncontended, see q2 spsc wait enable.
+ *
+ * Parameters:
+ *    q2_spsc_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the item to.
+ *    uint32_t timeout_us - Maximum time to wait in
+ *                          microseconds, or
+ *                          Q2_WAIT_FOREVER.
+ *
+ * Returns:
+ *    Q2_ERROR_TIMEOUT - Queue stayed empty for timeout_us.
+ *    Q2_SUCCESS - Successfully retrieved item from queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or output is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 spsc init or q2 spsc
+ *                               wait enable has not been
+ *                               called.
+ *********************************************************/
+uint32_t q2_spsc_get_wait(q2_spsc_context_t* const ctx, void* const output, uint32_t timeout_us);
+#endif
+
+#endif // Q2_SPSC_H
@@ -0,0 +1,102 @@
+/**********************************************************
+ * Name:
+ *     q2_typed.h
+ *
+ * Description:
+ *     Generator for type specialized power of two queues.
+ *     Items are assigned by type and the mask is a compile
+ *     time constant, so small items are moved in registers
+ *     instead of going through memcpy.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_TYPED_H
+#define Q2_TYPED_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    Q2_DEFINE_TYPED
+ *
+ * Description:
+ *    Defines the queue type name_t holding queue_size items
+ *    of struct_type, and the static inline functions
+ *    name_put, name_get, name_length, name_empty, name_full
+ *    and name_reset. A zero initialized name_t is an empty
+ *    queue, no init call is needed.
+ *
+ * Parameters:
+ *    name - Prefix for the generated type and functions.
+ *    struct_type - Type of the queued items.
+ *    queue_size - Capacity, must be a power of two.
+ *********************************************************/
+#define Q2_DEFINE_TYPED(name, struct_type, queue_size) \
+        _Static_assert(((queue_size) != 0) && (((queue_size) & ((queue_size) - 1)) == 0), \
+                       #name " queue size must be a power of two"); \
+        \
+        typedef struct \
+        { \
+            uint32_t head; \
+            uint32_t tail; \
+            struct_type data[queue_size]; \
+        } name##_t; \
+        \
+        static inline uint32_t name##_put(name##_t* const ctx, const struct_type input) \
+        { \
+            q2_return_t ret = Q2_SUCCESS; \
+            if((ctx->head - ctx->tail) == (uint32_t)(queue_size)) \
+            { \
+                ret = Q2_ERROR_FULL; \
+            } \
+            else \
+            { \
+                ctx->data[ctx->head & ((queue_size) - 1)] = input; \
+                ctx->head++; \
+            } \
+            return ret; \
+        } \
+        \
+        static inline uint32_t name##_get(name##_t* const ctx, struct_type* const output) \
+        { \
+            q2_return_t ret = Q2_SUCCESS; \
+            if(ctx->head == ctx->tail) \
+            { \
+                ret = Q2_ERROR_EMPTY; \
+            } \
+            else \
+            { \
+                *output = ctx->data[ctx->tail & ((queue_size) - 1)]; \
+                ctx->tail++; \
+            } \
+            return ret; \
+        } \
+        \
+        static inline uint32_t name##_length(const name##_t* const ctx) \
+        { \
+            return ctx->head - ctx->tail; \
+        } \
+        \
+        static inline bool name##_empty(const name##_t* const ctx) \
+        { \
+            return ctx->head == ctx->tail; \
+        } \
+        \
+        static inline bool name##_full(const name##_t* const ctx) \
+        { \
+            return (ctx->head - ctx->tail) == (uint32_t)(queue_size); \
+        } \
+        \
+        static inline void name##_reset(name##_t* const ctx) \
+        { \
+            ctx->head = 0; \
+            ctx->tail = 0; \
+        }
+
+#endif // Q2_TYPED_H
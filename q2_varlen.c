@@ -0,0 +1,512 @@
+/**********************************************************
+ * Name:
+ *     q2_varlen.c
+ *
+ * Description:
+ *     Implementation for lock-free single producer, single
+ *     consumer queue of variable length messages. Head and
+ *     tail are free running byte indices, the buffer offset
+ *     is taken by masking. Frames never straddle the wrap.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2_varlen.h"
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define Q2_VARLEN_MIN_BUFFER (16)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_VARLEN_FRAME_LENGTH(length) \
+        ((((length) + Q2_VARLEN_HEADER_LENGTH) + (Q2_VARLEN_ALIGN - 1)) & ~(uint32_t)(Q2_VARLEN_ALIGN - 1))
+
+/**********************************************************
+ * Static Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_varlen_front
+ *
+ * Description:
+ *    Finds the oldest message, skipping and freeing a pad
+ *    frame at the wrap. A pad is always published together
+ *    with the frame after it.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const tail - Set to the message's index.
+ *    uint32_t* const length - Set to the message length.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Message found.
+ *********************************************************/
+static q2_return_t q2_varlen_front(q2_varlen_context_t* const ctx, uint32_t* const tail, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t mask = ctx->buffer_length - 1;
+
+    *tail = atomic_load_explicit(&ctx->tail, memory_order_relaxed);
+
+    /* Only touch the producer's cache line when the cached head says empty */
+    if(ctx->head_cache == *tail)
+    {
+        ctx->head_cache = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        if(ctx->head_cache == *tail)
+        {
+            ret = Q2_ERROR_EMPTY;
+        }
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        memcpy(length, ctx->data + (*tail & mask), Q2_VARLEN_HEADER_LENGTH);
+        if(Q2_VARLEN_PAD == *length)
+        {
+            *tail += ctx->buffer_length - (*tail & mask);
+            atomic_store_explicit(&ctx->tail, *tail, memory_order_release);
+            memcpy(length, ctx->data, Q2_VARLEN_HEADER_LENGTH);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_varlen_init
+ *
+ * Description:
+ *    Initializes the varlen context. Checks that the buffer
+ *    length is a power of two of at least 16 bytes. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two, or
+ *                                       is too small.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_varlen_init(q2_varlen_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Check for power of two */
+        if(!((ctx->buffer_length & (ctx->buffer_length - 1)) == 0) || ctx->buffer_length < Q2_VARLEN_MIN_BUFFER)
+        {
+            ret = Q2_ERROR_LENGTH_NOT_POWER_OF_TWO;
+        }
+        else
+        {
+            atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+            atomic_store_explicit(&ctx->tail, 0, memory_order_relaxed);
+            ctx->tail_cache = 0;
+            ctx->head_cache = 0;
+            ctx->reserved = false;
+            ctx->initialized = true;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_reserve
+ *
+ * Description:
+ *    Returns a contiguous span of length bytes for the
+ *    producer to build a message in place. The message
+ *    becomes visible to the consumer once q2_varlen_commit
+ *    is called. A later reserve replaces an uncommitted one.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t length - Message length in bytes, at most
+ *                      Q2_VARLEN_MAX_MESSAGE.
+ *    void** const slot - Set to the start of the span.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Not enough free space.
+ *    Q2_SUCCESS - Successfully reserved the span.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or slot is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When length is too long.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_reserve(q2_varlen_context_t* const ctx, uint32_t length, void** const slot)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t head;
+    uint32_t offset;
+    uint32_t pad = 0;
+    uint32_t needed;
+    uint32_t pad_marker = Q2_VARLEN_PAD;
+
+    if(NULL == ctx || NULL == slot)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(length > Q2_VARLEN_MAX_MESSAGE(ctx->buffer_length))
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+        offset = head & (ctx->buffer_length - 1);
+
+        /* A frame that would straddle the wrap starts over at offset zero */
+        if(ctx->buffer_length - offset < Q2_VARLEN_FRAME_LENGTH(length))
+        {
+            pad = ctx->buffer_length - offset;
+        }
+        needed = pad + Q2_VARLEN_FRAME_LENGTH(length);
+
+        /* Only touch the consumer's cache line when the cached tail says full */
+        if(ctx->buffer_length - (head - ctx->tail_cache) < needed)
+        {
+            ctx->tail_cache = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+            if(ctx->buffer_length - (head - ctx->tail_cache) < needed)
+            {
+                ret = Q2_ERROR_FULL;
+            }
+        }
+
+        if(Q2_SUCCESS == ret)
+        {
+            /* Not visible until commit publishes head past it */
+            if(0 != pad)
+            {
+                memcpy(ctx->data + offset, &pad_marker, Q2_VARLEN_HEADER_LENGTH);
+            }
+
+            ctx->reserved_head = head + pad;
+            ctx->reserved_length = length;
+            ctx->reserved = true;
+            *slot = ctx->data + (ctx->reserved_head & (ctx->buffer_length - 1)) + Q2_VARLEN_HEADER_LENGTH;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_commit
+ *
+ * Description:
+ *    Publishes the message built through q2_varlen_reserve.
+ *    The message may be shorter than the reserved span.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully committed the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When nothing is reserved
+ *                                 or length is longer than
+ *                                 the reserved span.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_commit(q2_varlen_context_t* const ctx, uint32_t length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+    else if(false == ctx->reserved || length > ctx->reserved_length)
+    {
+        ret = Q2_ERROR_INVALID_PARAMETER;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        memcpy(ctx->data + (ctx->reserved_head & (ctx->buffer_length - 1)), &length, Q2_VARLEN_HEADER_LENGTH);
+        ctx->reserved = false;
+        atomic_store_explicit(&ctx->head, ctx->reserved_head + Q2_VARLEN_FRAME_LENGTH(length), memory_order_release);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_put
+ *
+ * Description:
+ *    Copies a message into the queue. Must only be called
+ *    from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    const void* const input - Message to be queued.
+ *    uint32_t length - Message length in bytes, at most
+ *                      Q2_VARLEN_MAX_MESSAGE.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Not enough free space.
+ *    Q2_SUCCESS - Successfully added message to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When length is too long.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_put(q2_varlen_context_t* const ctx, const void* const input, uint32_t length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    void* slot;
+
+    if(NULL == input)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+        ret = q2_varlen_reserve(ctx, length, &slot);
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        memcpy(slot, input, length);
+        ret = q2_varlen_commit(ctx, length);
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_peek
+ *
+ * Description:
+ *    Returns a pointer to the oldest message so the
+ *    consumer can process it in place. The message stays
+ *    queued until q2_varlen_release is called. Must only be
+ *    called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    void** const slot - Set to the start of the message.
+ *    uint32_t* const length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully peeked the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or length is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_peek(q2_varlen_context_t* const ctx, void** const slot, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+
+    if(NULL == ctx || NULL == slot || NULL == length)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ret = q2_varlen_front(ctx, &tail, length);
+        if(Q2_SUCCESS == ret)
+        {
+            *slot = ctx->data + (tail & (ctx->buffer_length - 1)) + Q2_VARLEN_HEADER_LENGTH;
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_release
+ *
+ * Description:
+ *    Frees the oldest message and publishes the tail index.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully released the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_release(q2_varlen_context_t* const ctx)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    uint32_t tail;
+    uint32_t length;
+
+    if(NULL == ctx)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        ret = q2_varlen_front(ctx, &tail, &length);
+        if(Q2_SUCCESS == ret)
+        {
+            atomic_store_explicit(&ctx->tail, tail + Q2_VARLEN_FRAME_LENGTH(length), memory_order_release);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_get
+ *
+ * Description:
+ *    Copies the oldest message out of the queue. A message
+ *    longer than capacity stays queued and its length is
+ *    returned so a larger buffer can be supplied. Must only
+ *    be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the message to.
+ *    uint32_t capacity - Size of output in bytes.
+ *    uint32_t* const length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or length is
+ *                              NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the message is longer
+ *                                 than capacity.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_get(q2_varlen_context_t* const ctx, void* const output, uint32_t capacity, uint32_t* const length)
+{
+    q2_return_t ret = Q2_SUCCESS;
+    void* slot;
+
+    if(NULL == output)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else
+    {
+        ret = q2_varlen_peek(ctx, &slot, length);
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        if(*length > capacity)
+        {
+            ret = Q2_ERROR_INVALID_PARAMETER;
+        }
+        else
+        {
+            memcpy(output, slot, *length);
+            ret = q2_varlen_release(ctx);
+        }
+    }
+
+    return ret;
+}
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_used
+ *
+ * Description:
+ *    Returns the number of buffer bytes in use, including
+ *    frame headers and padding. The value is a snapshot and
+ *    may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const used - Bytes in use.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved bytes in use.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or used is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_used(q2_varlen_context_t* const ctx, uint32_t* const used)
+{
+    q2_return_t ret = Q2_SUCCESS;
+
+    if(NULL == ctx || NULL == used)
+    {
+        ret = Q2_ERROR_NULL_PARAMETER;
+    }
+    else if(false == ctx->initialized)
+    {
+        ret = Q2_ERROR_NOT_INITIALIZED;
+    }
+
+    if(Q2_SUCCESS == ret)
+    {
+        /* Tail is loaded first so it never passes head, clamp for a racing commit */
+        uint32_t tail = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+        uint32_t head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+        *used = head - tail;
+        if(*used > ctx->buffer_length)
+        {
+            *used = ctx->buffer_length;
+        }
+    }
+
+    return ret;
+}
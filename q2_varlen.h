@@ -0,0 +1,270 @@
+/**********************************************************
+ * Name:
+ *     q2_varlen.h
+ *
+ * Description:
+ *     Header for lock-free single producer, single consumer
+ *     queue of variable length messages. Messages are packed
+ *     into a power of two byte buffer as length prefixed
+ *     frames, a pad frame skips the gap left at the wrap.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+#ifndef Q2_VARLEN_H
+#define Q2_VARLEN_H
+
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "q2.h"
+#include <stdatomic.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+/* Every frame starts with a length word and is padded to it */
+#define Q2_VARLEN_HEADER_LENGTH (sizeof(uint32_t))
+#define Q2_VARLEN_ALIGN         (sizeof(uint32_t))
+
+/* Length word of a frame that runs to the end of the buffer */
+#define Q2_VARLEN_PAD           (0xFFFFFFFF)
+
+/* Longest message a buffer of buffer_size bytes accepts */
+#define Q2_VARLEN_MAX_MESSAGE(buffer_size) (((buffer_size) / 2) - Q2_VARLEN_HEADER_LENGTH)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    /* Producer owned, head is published to the consumer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t head;
+    uint32_t tail_cache;
+    uint32_t reserved_head;
+    uint32_t reserved_length;
+    bool reserved;
+
+    /* Consumer owned, tail is published to the producer */
+    _Alignas(Q2_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+    uint32_t head_cache;
+
+    /* Read only after init */
+    _Alignas(Q2_CACHE_LINE_SIZE) bool initialized;
+    uint8_t* data;
+    uint32_t buffer_length;
+} q2_varlen_context_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+#define Q2_VARLEN(context_name, buffer_size) \
+        static uint32_t context_name##_array[(buffer_size) / sizeof(uint32_t)]; \
+        static q2_varlen_context_t context_name = { \
+            .head = 0, \
+            .tail_cache = 0, \
+            .reserved_head = 0, \
+            .reserved_length = 0, \
+            .reserved = false, \
+            .tail = 0, \
+            .head_cache = 0, \
+            .initialized = false, \
+            .data = (uint8_t*)context_name##_array, \
+            .buffer_length = buffer_size \
+        };
+
+/**********************************************************
+ * Prototypes
+ *********************************************************/
+/**********************************************************
+ * Name:
+ *    q2_varlen_init
+ *
+ * Description:
+ *    Initializes the varlen context. Checks that the buffer
+ *    length is a power of two of at least 16 bytes. Must be
+ *    called before the producer and consumer threads are
+ *    started.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_LENGTH_NOT_POWER_OF_TWO - Buffer size is not
+ *                                       a power of two, or
+ *                                       is too small.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_SUCCESS - Buffer size is a power of two, context
+ *                 initialized.
+ *********************************************************/
+uint32_t q2_varlen_init(q2_varlen_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_reserve
+ *
+ * Description:
+ *    Returns a contiguous span of length bytes for the
+ *    producer to build a message in place. The message
+ *    becomes visible to the consumer once q2_varlen_commit
+ *    is called. A later reserve replaces an uncommitted one.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t length - Message length in bytes, at most
+ *                      Q2_VARLEN_MAX_MESSAGE.
+ *    void** const slot - Set to the start of the span.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Not enough free space.
+ *    Q2_SUCCESS - Successfully reserved the span.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or slot is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When length is too long.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_reserve(q2_varlen_context_t* const ctx, uint32_t length, void** const slot);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_commit
+ *
+ * Description:
+ *    Publishes the message built through q2_varlen_reserve.
+ *    The message may be shorter than the reserved span.
+ *    Must only be called from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully committed the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When nothing is reserved
+ *                                 or length is longer than
+ *                                 the reserved span.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_commit(q2_varlen_context_t* const ctx, uint32_t length);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_put
+ *
+ * Description:
+ *    Copies a message into the queue. Must only be called
+ *    from the producer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    const void* const input - Message to be queued.
+ *    uint32_t length - Message length in bytes, at most
+ *                      Q2_VARLEN_MAX_MESSAGE.
+ *
+ * Returns:
+ *    Q2_ERROR_FULL - Not enough free space.
+ *    Q2_SUCCESS - Successfully added message to queue.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or input is NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When length is too long.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_put(q2_varlen_context_t* const ctx, const void* const input, uint32_t length);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_peek
+ *
+ * Description:
+ *    Returns a pointer to the oldest message so the
+ *    consumer can process it in place. The message stays
+ *    queued until q2_varlen_release is called. Must only be
+ *    called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    void** const slot - Set to the start of the message.
+ *    uint32_t* const length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully peeked the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, slot or length is
+ *                              NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_peek(q2_varlen_context_t* const ctx, void** const slot, uint32_t* const length);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_release
+ *
+ * Description:
+ *    Frees the oldest message and publishes the tail index.
+ *    Must only be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully released the message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_release(q2_varlen_context_t* const ctx);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_get
+ *
+ * Description:
+ *    Copies the oldest message out of the queue. A message
+ *    longer than capacity stays queued and its length is
+ *    returned so a larger buffer can be supplied. Must only
+ *    be called from the consumer thread.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    void* const output - Location to copy the message to.
+ *    uint32_t capacity - Size of output in bytes.
+ *    uint32_t* const length - Message length in bytes.
+ *
+ * Returns:
+ *    Q2_ERROR_EMPTY - Queue is empty.
+ *    Q2_SUCCESS - Successfully retrieved message.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx, output or length is
+ *                              NULL.
+ *    Q2_ERROR_INVALID_PARAMETER - When the message is longer
+ *                                 than capacity.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_get(q2_varlen_context_t* const ctx, void* const output, uint32_t capacity, uint32_t* const length);
+
+/**********************************************************
+ * Name:
+ *    q2_varlen_used
+ *
+ * Description:
+ *    Returns the number of buffer bytes in use, including
+ *    frame headers and padding. The value is a snapshot and
+ *    may be stale by the time it is used.
+ *
+ * Parameters:
+ *    q2_varlen_context_t* const ctx - Pointer to the context.
+ *    uint32_t* const used - Bytes in use.
+ *
+ * Returns:
+ *    Q2_SUCCESS - Successfully retrieved bytes in use.
+ *    Q2_ERROR_NULL_PARAMETER - When ctx or used is NULL.
+ *    Q2_ERROR_NOT_INITIALIZED - When q2 varlen init has not
+ *                               been called.
+ *********************************************************/
+uint32_t q2_varlen_used(q2_varlen_context_t* const ctx, uint32_t* const used);
+
+#endif // Q2_VARLEN_H
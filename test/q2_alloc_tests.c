@@ -0,0 +1,180 @@
+/**********************************************************
+ * Name:
+ *     q2_alloc_tests.c
+ *
+ * Description:
+ *     Unity tests for runtime created power of two queues.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_alloc.h"
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_alloc_fill_and_empty(q2_context_t* const ctx)
+{
+    uint64_t input;
+    uint64_t output;
+    uint32_t i;
+
+    for(i = 0; i < ctx->max_length; i++)
+    {
+        input = i;
+        TEST_ASSERT_EQUAL(q2_put(ctx, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_put(ctx, &input), Q2_ERROR_FULL);
+
+    for(i = 0; i < ctx->max_length; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_get(ctx, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(i, output);
+    }
+    TEST_ASSERT_EQUAL(q2_get(ctx, &output), Q2_ERROR_EMPTY);
+}
+
+void test_q2_create_should_CreateAlignedQueue(void)
+{
+    q2_context_t* ctx = NULL;
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 1024, NULL), Q2_SUCCESS);
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_TRUE(ctx->initialized);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)ctx->data % Q2_CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL(1024, ctx->max_length);
+    TEST_ASSERT_EQUAL(sizeof(uint64_t), ctx->item_length);
+
+    test_helper_q2_alloc_fill_and_empty(ctx);
+    TEST_ASSERT_EQUAL(q2_destroy(ctx), Q2_SUCCESS);
+}
+
+void test_q2_create_should_NotCreateQueue(void)
+{
+    q2_context_t* ctx = (q2_context_t*)&ctx;
+    q2_alloc_options_t options = { .pages = Q2_PAGES_DEFAULT, .numa_node = Q2_NUMA_NODE_MAX };
+    TEST_ASSERT_EQUAL(q2_create(NULL, sizeof(uint64_t), 16, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 12, NULL), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_NULL(ctx);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 0, NULL), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, 0, 16, NULL), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, 0x10000, 0x10000, NULL), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, 2, 0x80000000, NULL), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 16, &options), Q2_ERROR_INVALID_PARAMETER);
+    options.numa_node = -2;
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 16, &options), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_NULL(ctx);
+    TEST_ASSERT_EQUAL(q2_destroy(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_create_should_CreateTransparentHugePageQueue(void)
+{
+    q2_context_t* ctx = NULL;
+    q2_alloc_options_t options = { .pages = Q2_PAGES_HUGE_TRANSPARENT, .numa_node = Q2_NUMA_NODE_ANY };
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 512 * 1024, &options), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)ctx->data % Q2_HUGE_PAGE_SIZE);
+
+    test_helper_q2_alloc_fill_and_empty(ctx);
+    TEST_ASSERT_EQUAL(q2_destroy(ctx), Q2_SUCCESS);
+}
+
+void test_q2_create_should_CreateOrRejectExplicitHugePageQueue(void)
+{
+    q2_context_t* ctx = NULL;
+    q2_alloc_options_t options = { .pages = Q2_PAGES_HUGE_EXPLICIT, .numa_node = Q2_NUMA_NODE_ANY };
+    uint32_t ret = q2_create(&ctx, sizeof(uint64_t), 64, &options);
+
+    /* Depends on huge pages having been reserved on this machine */
+    if(Q2_SUCCESS == ret)
+    {
+        TEST_ASSERT_EQUAL(0, (uintptr_t)ctx->data % Q2_HUGE_PAGE_SIZE);
+        test_helper_q2_alloc_fill_and_empty(ctx);
+        TEST_ASSERT_EQUAL(q2_destroy(ctx), Q2_SUCCESS);
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL(Q2_ERROR_ALLOCATION, ret);
+        TEST_ASSERT_NULL(ctx);
+    }
+}
+
+void test_q2_create_should_CreateNumaLocalQueue(void)
+{
+    q2_context_t* ctx = NULL;
+    q2_alloc_options_t options = { .pages = Q2_PAGES_DEFAULT, .numa_node = 0 };
+    uint32_t ret = q2_create(&ctx, sizeof(uint64_t), 256, &options);
+
+    /* Node zero always exists, binding may still be refused in a container */
+    if(Q2_SUCCESS == ret)
+    {
+        test_helper_q2_alloc_fill_and_empty(ctx);
+        TEST_ASSERT_EQUAL(q2_destroy(ctx), Q2_SUCCESS);
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL(Q2_ERROR_ALLOCATION, ret);
+    }
+}
+
+void test_q2_create_should_CreateMirroredQueue(void)
+{
+    q2_context_t* ctx = NULL;
+    q2_alloc_options_t options = { .pages = Q2_PAGES_DEFAULT, .numa_node = Q2_NUMA_NODE_ANY, .mirrored = true };
+    uint64_t input[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint64_t output[8];
+    uint64_t* slot;
+    uint32_t count;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 16, &options), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_create(&ctx, sizeof(uint64_t), 512, &options), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(ctx->mirrored);
+
+    /* The second view aliases the first, volatile so the compiler keeps the store before the load */
+    ((volatile uint64_t*)ctx->data)[0] = 0xABCD;
+    TEST_ASSERT_EQUAL(0xABCD, ((volatile uint64_t*)ctx->data)[512]);
+
+    /* Move head and tail to four items before the wrap */
+    for(i = 0; i < 508; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_put(ctx, input), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(q2_get(ctx, output), Q2_SUCCESS);
+    }
+
+    /* Spans run past the end of the buffer */
+    TEST_ASSERT_EQUAL(q2_reserve(ctx, 8, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(8, count);
+    for(i = 0; i < 8; i++)
+    {
+        slot[i] = input[i];
+    }
+    TEST_ASSERT_EQUAL(q2_commit(ctx, 8), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, ((uint64_t*)ctx->data)[0]);
+
+    TEST_ASSERT_EQUAL(q2_peek(ctx, 8, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(8, count);
+    TEST_ASSERT_EQUAL_MEMORY(input, slot, sizeof(input));
+    TEST_ASSERT_EQUAL(q2_release(ctx, 8), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_put_n(ctx, input, 8, true, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(ctx, output, 8, true, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL_MEMORY(input, output, sizeof(input));
+
+    test_helper_q2_alloc_fill_and_empty(ctx);
+    TEST_ASSERT_EQUAL(q2_destroy(ctx), Q2_SUCCESS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_create_should_CreateAlignedQueue);
+    RUN_TEST(test_q2_create_should_NotCreateQueue);
+    RUN_TEST(test_q2_create_should_CreateTransparentHugePageQueue);
+    RUN_TEST(test_q2_create_should_CreateOrRejectExplicitHugePageQueue);
+    RUN_TEST(test_q2_create_should_CreateNumaLocalQueue);
+    RUN_TEST(test_q2_create_should_CreateMirroredQueue);
+    return UNITY_END();
+}
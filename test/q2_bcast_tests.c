@@ -0,0 +1,217 @@
+/**********************************************************
+ * Name:
+ *     q2_bcast_tests.c
+ *
+ * Description:
+ *     Unity tests for broadcast queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_bcast.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (100000)
+#define TEST_CONSUMER_COUNT (3)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_BCAST(q2_bcast_ctx1, uint32_t, 4, 2);
+Q2_BCAST(q2_bcast_ctx2, uint32_t, 64, TEST_CONSUMER_COUNT);
+
+// Invalid size initializers (not power of two, no consumers)
+Q2_BCAST(q2_bcast_ctx3, uint32_t, 12, 1);
+Q2_BCAST(q2_bcast_ctx4, uint32_t, 4, 0);
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static uint32_t test_sum;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    q2_bcast_ctx1.initialized = false;
+    q2_bcast_ctx2.initialized = false;
+    test_sum = 0;
+}
+
+bool test_helper_q2_bcast_sum(void* const item, void* const arg)
+{
+    (void)arg;
+    test_sum += *(uint32_t*)item;
+    return true;
+}
+
+void* test_helper_q2_bcast_consumer(void* arg)
+{
+    uint32_t consumer = *(uint32_t*)arg;
+    uint32_t expected = 0;
+    uint32_t output;
+    bool ordered = true;
+
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_bcast_get(&q2_bcast_ctx2, consumer, &output))
+        {
+            if(expected != output)
+            {
+                ordered = false;
+            }
+            expected++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    *(uint32_t*)arg = (true == ordered) ? 1 : 0;
+    return NULL;
+}
+
+void test_q2_bcast_init_should_InitializeContext(void)
+{
+    uint32_t consumer;
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx4), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_init(NULL), Q2_ERROR_NULL_PARAMETER);
+
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &consumer), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, consumer);
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &consumer), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, consumer);
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &consumer), Q2_ERROR_FULL);
+}
+
+void test_q2_bcast_should_NotPutOrGet(void)
+{
+    uint32_t item = 0;
+    uint32_t count;
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_put(&q2_bcast_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, &item, 1, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, 0, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, 0, test_helper_q2_bcast_sum, NULL, Q2_NO_LIMIT, Q2_NO_LIMIT, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_length(&q2_bcast_ctx1, 0, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_add(NULL, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_put(&q2_bcast_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, &item, 1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, 0, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, 0, NULL, NULL, Q2_NO_LIMIT, Q2_NO_LIMIT, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_length(NULL, 0, &count), Q2_ERROR_NULL_PARAMETER);
+
+    /* Consumer indices must come from q2 bcast add */
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, 0, &item), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_length(&q2_bcast_ctx1, 0, &count), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, 1, &item), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, 0, &item), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, 0, test_helper_q2_bcast_sum, NULL, Q2_NO_LIMIT, Q2_NO_LIMIT, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_q2_bcast_should_DeliverEveryItemToEveryConsumer(void)
+{
+    uint32_t input[4] = { 1, 2, 3, 4 };
+    uint32_t output;
+    uint32_t fast;
+    uint32_t slow;
+    uint32_t transferred;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx1), Q2_SUCCESS);
+
+    /* With no consumers nothing holds the producer back */
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, input, 4, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, input, 2, &transferred), Q2_SUCCESS);
+
+    /* Consumers only see items published after they join */
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &fast), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx1, &slow), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, fast, &output), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, input, 4, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, transferred);
+    TEST_ASSERT_EQUAL(q2_bcast_put(&q2_bcast_ctx1, &input[0]), Q2_ERROR_FULL);
+
+    /* The slowest cursor bounds the producer */
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, fast, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, output);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, fast, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, output);
+    TEST_ASSERT_EQUAL(q2_bcast_put(&q2_bcast_ctx1, &input[0]), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, slow, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, output);
+    TEST_ASSERT_EQUAL(q2_bcast_put_n(&q2_bcast_ctx1, input, 4, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, transferred);
+    TEST_ASSERT_EQUAL(q2_bcast_length(&q2_bcast_ctx1, fast, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, length);
+    TEST_ASSERT_EQUAL(q2_bcast_length(&q2_bcast_ctx1, slow, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+
+    /* Both read the same items, wrapping, in one batch */
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, fast, test_helper_q2_bcast_sum, NULL, Q2_NO_LIMIT, Q2_NO_LIMIT, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, transferred);
+    TEST_ASSERT_EQUAL(3 + 4 + 1, test_sum);
+    test_sum = 0;
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, slow, test_helper_q2_bcast_sum, NULL, 2, Q2_NO_LIMIT, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, transferred);
+    TEST_ASSERT_EQUAL(q2_bcast_drain(&q2_bcast_ctx1, slow, test_helper_q2_bcast_sum, NULL, Q2_NO_LIMIT, sizeof(uint32_t), &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, transferred);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, slow, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, output);
+    TEST_ASSERT_EQUAL(2 + 3 + 4, test_sum);
+    TEST_ASSERT_EQUAL(q2_bcast_get(&q2_bcast_ctx1, slow, &output), Q2_ERROR_EMPTY);
+}
+
+void test_q2_bcast_should_KeepOrderForEveryConsumerThread(void)
+{
+    pthread_t consumers[TEST_CONSUMER_COUNT];
+    uint32_t results[TEST_CONSUMER_COUNT];
+    uint32_t input;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_bcast_init(&q2_bcast_ctx2), Q2_SUCCESS);
+    for(i = 0; i < TEST_CONSUMER_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_bcast_add(&q2_bcast_ctx2, &results[i]), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(pthread_create(&consumers[i], NULL, test_helper_q2_bcast_consumer, &results[i]), 0);
+    }
+
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        while(Q2_SUCCESS != q2_bcast_put(&q2_bcast_ctx2, &input))
+        {
+            sched_yield();
+        }
+    }
+
+    for(i = 0; i < TEST_CONSUMER_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(pthread_join(consumers[i], NULL), 0);
+        TEST_ASSERT_EQUAL(1, results[i]);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_bcast_init_should_InitializeContext);
+    RUN_TEST(test_q2_bcast_should_NotPutOrGet);
+    RUN_TEST(test_q2_bcast_should_DeliverEveryItemToEveryConsumer);
+    RUN_TEST(test_q2_bcast_should_KeepOrderForEveryConsumerThread);
+    return UNITY_END();
+}
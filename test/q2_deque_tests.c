@@ -0,0 +1,219 @@
+/**********************************************************
+ * Name:
+ *     q2_deque_tests.c
+ *
+ * Description:
+ *     Unity tests for lock-free work stealing deque.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_deque.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (100000)
+#define TEST_THIEF_COUNT (3)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    uint32_t id;
+    uint8_t  payload[12];
+} test_task_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_DEQUE(q2_deque_ctx1, test_task_t, 4);
+Q2_DEQUE(q2_deque_ctx2, uint32_t, 64);
+
+// Invalid size initializer (not power of two)
+Q2_DEQUE(q2_deque_ctx3, uint32_t, 12);
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static _Atomic bool test_owner_done;
+static uint8_t test_seen[TEST_THREADED_ITEM_COUNT];
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_deque_context_clear(q2_deque_context_t* const ctx)
+{
+    memset(ctx->data, 0x00, ctx->item_length * ctx->max_length);
+    ctx->initialized = false;
+}
+
+void setUp(void)
+{
+    test_helper_q2_deque_context_clear(&q2_deque_ctx1);
+    test_helper_q2_deque_context_clear(&q2_deque_ctx2);
+    test_helper_q2_deque_context_clear(&q2_deque_ctx3);
+}
+
+void* test_helper_q2_deque_thief(void* arg)
+{
+    uint32_t* stolen = arg;
+    uint32_t output;
+    uint32_t ret;
+    bool done;
+
+    /* Each item is counted by whoever takes it, a double take shows as a count above one */
+    do
+    {
+        done = atomic_load(&test_owner_done);
+        ret = q2_deque_steal(&q2_deque_ctx2, &output);
+        if(Q2_SUCCESS == ret)
+        {
+            test_seen[output]++;
+            *stolen += 1;
+        }
+        else
+        {
+            sched_yield();
+        }
+    } while(false == done || Q2_SUCCESS == ret);
+
+    return NULL;
+}
+
+void test_q2_deque_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_deque_init(&q2_deque_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_deque_init(&q2_deque_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_deque_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_deque_should_NotPushPopOrSteal(void)
+{
+    test_task_t task = { 0 };
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_deque_push(&q2_deque_ctx1, &task), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &task), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_deque_steal(&q2_deque_ctx1, &task), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_deque_length(&q2_deque_ctx1, &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_deque_init(&q2_deque_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_deque_push(NULL, &task), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_deque_push(&q2_deque_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_deque_steal(&q2_deque_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_deque_length(&q2_deque_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &task), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_deque_steal(&q2_deque_ctx1, &task), Q2_ERROR_EMPTY);
+}
+
+void test_q2_deque_should_PopBottomAndStealTop(void)
+{
+    test_task_t input = { 0 };
+    test_task_t output;
+    uint32_t length;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_deque_init(&q2_deque_ctx1), Q2_SUCCESS);
+
+    /* Go around the ring several times to exercise the free running indices */
+    for(i = 0; i < 5; i++)
+    {
+        for(input.id = 0; input.id < 4; input.id++)
+        {
+            input.payload[11] = (uint8_t)(input.id + 100);
+            TEST_ASSERT_EQUAL(q2_deque_push(&q2_deque_ctx1, &input), Q2_SUCCESS);
+        }
+        TEST_ASSERT_EQUAL(q2_deque_push(&q2_deque_ctx1, &input), Q2_ERROR_FULL);
+        TEST_ASSERT_EQUAL(q2_deque_length(&q2_deque_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(4, length);
+
+        /* Owner is LIFO, thieves are FIFO */
+        TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(3, output.id);
+        TEST_ASSERT_EQUAL(103, output.payload[11]);
+        TEST_ASSERT_EQUAL(q2_deque_steal(&q2_deque_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(0, output.id);
+        TEST_ASSERT_EQUAL(100, output.payload[11]);
+        TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(2, output.id);
+        TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(1, output.id);
+        TEST_ASSERT_EQUAL(q2_deque_pop(&q2_deque_ctx1, &output), Q2_ERROR_EMPTY);
+        TEST_ASSERT_EQUAL(q2_deque_steal(&q2_deque_ctx1, &output), Q2_ERROR_EMPTY);
+        TEST_ASSERT_EQUAL(q2_deque_length(&q2_deque_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(0, length);
+    }
+}
+
+void test_q2_deque_should_TakeEveryItemOnceWithThieves(void)
+{
+    pthread_t thieves[TEST_THIEF_COUNT];
+    uint32_t stolen[TEST_THIEF_COUNT] = { 0 };
+    uint32_t input;
+    uint32_t output;
+    uint32_t popped = 0;
+    uint32_t total;
+    uint32_t i;
+    bool once = true;
+    memset(test_seen, 0x00, sizeof(test_seen));
+    atomic_store(&test_owner_done, false);
+    TEST_ASSERT_EQUAL(q2_deque_init(&q2_deque_ctx2), Q2_SUCCESS);
+    for(i = 0; i < TEST_THIEF_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(pthread_create(&thieves[i], NULL, test_helper_q2_deque_thief, &stolen[i]), 0);
+    }
+
+    /* Owner pushes every item and pops after every other push, racing the thieves */
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        while(Q2_ERROR_FULL == q2_deque_push(&q2_deque_ctx2, &input))
+        {
+            sched_yield();
+        }
+        if(1 == (input % 2) && Q2_SUCCESS == q2_deque_pop(&q2_deque_ctx2, &output))
+        {
+            test_seen[output]++;
+            popped++;
+        }
+    }
+    atomic_store(&test_owner_done, true);
+
+    total = popped;
+    for(i = 0; i < TEST_THIEF_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(pthread_join(thieves[i], NULL), 0);
+        total += stolen[i];
+    }
+    while(Q2_SUCCESS == q2_deque_pop(&q2_deque_ctx2, &output))
+    {
+        test_seen[output]++;
+        total++;
+    }
+
+    for(i = 0; i < TEST_THREADED_ITEM_COUNT; i++)
+    {
+        if(1 != test_seen[i])
+        {
+            once = false;
+        }
+    }
+    TEST_ASSERT_TRUE(once);
+    TEST_ASSERT_EQUAL(TEST_THREADED_ITEM_COUNT, total);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_deque_init_should_InitializeContext);
+    RUN_TEST(test_q2_deque_should_NotPushPopOrSteal);
+    RUN_TEST(test_q2_deque_should_PopBottomAndStealTop);
+    RUN_TEST(test_q2_deque_should_TakeEveryItemOnceWithThieves);
+    return UNITY_END();
+}
@@ -0,0 +1,211 @@
+/**********************************************************
+ * Name:
+ *     q2_grow_tests.c
+ *
+ * Description:
+ *     Unity tests for growable single producer, single
+ *     consumer queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_grow.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (200000)
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static q2_grow_context_t q2_grow_ctx;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    memset(&q2_grow_ctx, 0x00, sizeof(q2_grow_ctx));
+}
+
+void* test_helper_q2_grow_producer(void* arg)
+{
+    q2_grow_context_t* ctx = arg;
+    uint64_t input;
+
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        while(Q2_SUCCESS != q2_grow_put(ctx, &input))
+        {
+            sched_yield();
+        }
+
+        /* Bursts let the consumer fall behind, pauses let it catch up */
+        if(0 == (input % 4096))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_grow_create_should_NotCreateQueue(void)
+{
+    q2_grow_options_t options = { .max_length = 12, .shrink = false };
+    uint64_t item = 0;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_grow_length(&q2_grow_ctx, &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(&q2_grow_ctx), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_grow_create(NULL, sizeof(uint64_t), 4, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 3, NULL), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 0, NULL), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 4, &options), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    options.max_length = 2;
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 4, &options), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, 0, 4, NULL), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_FALSE(q2_grow_ctx.initialized);
+
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 4, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_grow_put(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_get(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_length(&q2_grow_ctx, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &item), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(&q2_grow_ctx), Q2_SUCCESS);
+}
+
+void test_q2_grow_should_DoubleAndKeepOrder(void)
+{
+    q2_grow_options_t options = { .max_length = 8, .shrink = false };
+    uint64_t input;
+    uint64_t output;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 2, &options), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, q2_grow_ctx.producer->max_length);
+
+    /* Segments of 2, 4 and 8 hold 14 items before the cap */
+    for(input = 0; input < 3; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(4, q2_grow_ctx.producer->max_length);
+    TEST_ASSERT_EQUAL(2, q2_grow_ctx.consumer->max_length);
+    for(; input < 14; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(8, q2_grow_ctx.producer->max_length);
+    TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_grow_length(&q2_grow_ctx, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(14, length);
+
+    /* Old segments are read out in order and freed on the way */
+    for(input = 0; input < 7; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_grow_ctx.producer, q2_grow_ctx.consumer);
+
+    /* Room freed in the last segment is reused without growing */
+    input = 14;
+    TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_SUCCESS);
+    for(input = 7; input < 15; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_grow_length(&q2_grow_ctx, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, length);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(&q2_grow_ctx), Q2_SUCCESS);
+}
+
+void test_q2_grow_should_ShrinkWhenIdle(void)
+{
+    q2_grow_options_t options = { .max_length = Q2_GROW_MAX_LENGTH, .shrink = true };
+    uint64_t input;
+    uint64_t output;
+    uint64_t expected = 0;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 2, &options), Q2_SUCCESS);
+
+    /* A burst of 15 ends in a segment of 16 */
+    for(input = 0; input < 15; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(16, q2_grow_ctx.producer->max_length);
+    for(i = 0; i < 15; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(expected++, output);
+    }
+
+    /* Light traffic halves the segment after each lap, down to the minimum */
+    for(i = 0; i < 64; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_grow_put(&q2_grow_ctx, &input), Q2_SUCCESS);
+        input++;
+        TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(expected++, output);
+    }
+    TEST_ASSERT_EQUAL(2, q2_grow_ctx.producer->max_length);
+    TEST_ASSERT_EQUAL(q2_grow_ctx.producer, q2_grow_ctx.consumer);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(&q2_grow_ctx), Q2_SUCCESS);
+}
+
+void test_q2_grow_should_TransferInOrderBetweenThreads(void)
+{
+    q2_grow_options_t options = { .max_length = 1024, .shrink = true };
+    pthread_t producer;
+    uint64_t expected = 0;
+    uint64_t output;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_grow_create(&q2_grow_ctx, sizeof(uint64_t), 2, &options), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_grow_producer, &q2_grow_ctx), 0);
+
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_grow_get(&q2_grow_ctx, &output))
+        {
+            if(expected != output)
+            {
+                in_order = false;
+            }
+            expected++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_EQUAL(q2_grow_get(&q2_grow_ctx, &output), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_grow_destroy(&q2_grow_ctx), Q2_SUCCESS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_grow_create_should_NotCreateQueue);
+    RUN_TEST(test_q2_grow_should_DoubleAndKeepOrder);
+    RUN_TEST(test_q2_grow_should_ShrinkWhenIdle);
+    RUN_TEST(test_q2_grow_should_TransferInOrderBetweenThreads);
+    return UNITY_END();
+}
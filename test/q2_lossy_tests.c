@@ -0,0 +1,166 @@
+/**********************************************************
+ * Name:
+ *     q2_lossy_tests.c
+ *
+ * Description:
+ *     Unity tests for lock-free power of two queue that
+ *     overwrites the oldest items.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_lossy.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (200000)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_LOSSY(q2_lossy_ctx1, uint32_t, 4);
+Q2_LOSSY(q2_lossy_ctx2, uint64_t, 64);
+
+// Invalid size initializer (not power of two)
+Q2_LOSSY(q2_lossy_ctx3, uint32_t, 5);
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_lossy_context_clear(q2_lossy_context_t* const ctx)
+{
+    memset(ctx->data, 0x00, ctx->item_length * ctx->max_length);
+    ctx->initialized = false;
+}
+
+void setUp(void)
+{
+    test_helper_q2_lossy_context_clear(&q2_lossy_ctx1);
+    test_helper_q2_lossy_context_clear(&q2_lossy_ctx2);
+    test_helper_q2_lossy_context_clear(&q2_lossy_ctx3);
+}
+
+void* test_helper_q2_lossy_producer(void* arg)
+{
+    uint64_t input;
+    (void)arg;
+
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        (void)q2_lossy_put(&q2_lossy_ctx2, &input);
+        if(0 == (input % 1024))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_lossy_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_lossy_init(&q2_lossy_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_lossy_init(&q2_lossy_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_lossy_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_lossy_should_NotPutOrGet(void)
+{
+    uint32_t item = 0;
+    uint32_t lost;
+    TEST_ASSERT_EQUAL(q2_lossy_put(&q2_lossy_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &item, &lost), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_lossy_length(&q2_lossy_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_lossy_init(&q2_lossy_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_lossy_put(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_lossy_put(&q2_lossy_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, NULL, &lost), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &item, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_lossy_length(&q2_lossy_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_lossy_should_OverwriteOldestAndCountLost(void)
+{
+    uint32_t input;
+    uint32_t output;
+    uint32_t length;
+    uint32_t lost;
+    TEST_ASSERT_EQUAL(q2_lossy_init(&q2_lossy_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &output, &lost), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, lost);
+
+    /* Ten puts into four slots, the first six are lost */
+    for(input = 0; input < 10; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_lossy_put(&q2_lossy_ctx1, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_lossy_length(&q2_lossy_ctx1, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &output, &lost), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(6, output);
+    TEST_ASSERT_EQUAL(6, lost);
+    for(input = 7; input < 10; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &output, &lost), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+        TEST_ASSERT_EQUAL(0, lost);
+    }
+    TEST_ASSERT_EQUAL(q2_lossy_get(&q2_lossy_ctx1, &output, &lost), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_lossy_length(&q2_lossy_ctx1, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, length);
+}
+
+void test_q2_lossy_should_AccountForEveryItemBetweenThreads(void)
+{
+    pthread_t producer;
+    uint64_t expected = 0;
+    uint64_t output;
+    uint64_t received = 0;
+    uint64_t total_lost = 0;
+    uint32_t lost;
+    bool consistent = true;
+    TEST_ASSERT_EQUAL(q2_lossy_init(&q2_lossy_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_lossy_producer, NULL), 0);
+
+    /* Every item is either received in order or reported lost */
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_lossy_get(&q2_lossy_ctx2, &output, &lost))
+        {
+            if(expected + lost != output)
+            {
+                consistent = false;
+            }
+            expected = output + 1;
+            received++;
+        }
+        else
+        {
+            sched_yield();
+        }
+        total_lost += lost;
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(consistent);
+    TEST_ASSERT_EQUAL(TEST_THREADED_ITEM_COUNT, received + total_lost);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_lossy_init_should_InitializeContext);
+    RUN_TEST(test_q2_lossy_should_NotPutOrGet);
+    RUN_TEST(test_q2_lossy_should_OverwriteOldestAndCountLost);
+    RUN_TEST(test_q2_lossy_should_AccountForEveryItemBetweenThreads);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+/**********************************************************
+ * Name:
+ *     q2_mpmc_tests.c
+ *
+ * Description:
+ *     Unity tests for bounded lock-free multi producer,
+ *     multi consumer power of two queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_mpmc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREAD_COUNT        (4)
+#define TEST_ITEMS_PER_PRODUCER  (100000)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_MPMC(q2_mpmc_ctx1, uint32_t, 4);
+Q2_MPMC(q2_mpmc_ctx2, uint32_t, 64);
+
+// Invalid size initializer (not power of two)
+Q2_MPMC(q2_mpmc_ctx3, uint32_t, 6);
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static _Atomic uint32_t test_seen[TEST_THREAD_COUNT * TEST_ITEMS_PER_PRODUCER];
+static _Atomic uint32_t test_consumed;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_mpmc_context_clear(q2_mpmc_context_t* const ctx)
+{
+    memset(ctx->data, 0x00, ctx->item_length * ctx->max_length);
+    ctx->initialized = false;
+}
+
+void setUp(void)
+{
+    test_helper_q2_mpmc_context_clear(&q2_mpmc_ctx1);
+    test_helper_q2_mpmc_context_clear(&q2_mpmc_ctx2);
+    test_helper_q2_mpmc_context_clear(&q2_mpmc_ctx3);
+}
+
+void* test_helper_q2_mpmc_producer(void* arg)
+{
+    uint32_t first = (uint32_t)(uintptr_t)arg * TEST_ITEMS_PER_PRODUCER;
+    uint32_t input;
+
+    for(input = first; input < first + TEST_ITEMS_PER_PRODUCER; input++)
+    {
+        while(Q2_ERROR_FULL == q2_mpmc_put(&q2_mpmc_ctx2, &input))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void* test_helper_q2_mpmc_consumer(void* arg)
+{
+    uint32_t output;
+    (void)arg;
+
+    while(atomic_load(&test_consumed) < TEST_THREAD_COUNT * TEST_ITEMS_PER_PRODUCER)
+    {
+        if(Q2_SUCCESS == q2_mpmc_get(&q2_mpmc_ctx2, &output))
+        {
+            atomic_fetch_add(&test_seen[output], 1);
+            atomic_fetch_add(&test_consumed, 1);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_mpmc_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_mpmc_init(&q2_mpmc_ctx1), Q2_SUCCESS);
+}
+
+void test_q2_mpmc_init_should_NotInitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_mpmc_init(&q2_mpmc_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_mpmc_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_mpmc_should_NotPutOrGet(void)
+{
+    uint32_t item = 0x12345678;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_mpmc_put(&q2_mpmc_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_mpmc_get(&q2_mpmc_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_mpmc_length(&q2_mpmc_ctx1, &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_mpmc_init(&q2_mpmc_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_mpmc_put(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_mpmc_put(&q2_mpmc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_mpmc_get(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_mpmc_get(&q2_mpmc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_mpmc_length(&q2_mpmc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_mpmc_should_FillAndEmptyAcrossWrap(void)
+{
+    uint32_t input = 0;
+    uint32_t output;
+    uint32_t length;
+    uint32_t i;
+    uint32_t j;
+    TEST_ASSERT_EQUAL(q2_mpmc_init(&q2_mpmc_ctx1), Q2_SUCCESS);
+
+    for(i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_mpmc_get(&q2_mpmc_ctx1, &output), Q2_ERROR_EMPTY);
+        for(j = 0; j < 4; j++)
+        {
+            TEST_ASSERT_EQUAL(q2_mpmc_put(&q2_mpmc_ctx1, &input), Q2_SUCCESS);
+            input++;
+        }
+        TEST_ASSERT_EQUAL(q2_mpmc_put(&q2_mpmc_ctx1, &input), Q2_ERROR_FULL);
+        TEST_ASSERT_EQUAL(q2_mpmc_length(&q2_mpmc_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(4, length);
+
+        for(j = 4; j > 0; j--)
+        {
+            TEST_ASSERT_EQUAL(q2_mpmc_get(&q2_mpmc_ctx1, &output), Q2_SUCCESS);
+            TEST_ASSERT_EQUAL(input - j, output);
+        }
+        TEST_ASSERT_EQUAL(q2_mpmc_length(&q2_mpmc_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(0, length);
+    }
+}
+
+void test_q2_mpmc_should_DeliverEachItemOnceBetweenThreads(void)
+{
+    pthread_t producers[TEST_THREAD_COUNT];
+    pthread_t consumers[TEST_THREAD_COUNT];
+    uint32_t output;
+    uint32_t i;
+    bool once = true;
+    TEST_ASSERT_EQUAL(q2_mpmc_init(&q2_mpmc_ctx2), Q2_SUCCESS);
+
+    for(i = 0; i < TEST_THREAD_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(pthread_create(&consumers[i], NULL, test_helper_q2_mpmc_consumer, NULL), 0);
+        TEST_ASSERT_EQUAL(pthread_create(&producers[i], NULL, test_helper_q2_mpmc_producer, (void*)(uintptr_t)i), 0);
+    }
+
+    for(i = 0; i < TEST_THREAD_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(pthread_join(producers[i], NULL), 0);
+        TEST_ASSERT_EQUAL(pthread_join(consumers[i], NULL), 0);
+    }
+
+    for(i = 0; i < TEST_THREAD_COUNT * TEST_ITEMS_PER_PRODUCER; i++)
+    {
+        if(1 != atomic_load(&test_seen[i]))
+        {
+            once = false;
+        }
+    }
+    TEST_ASSERT_TRUE(once);
+    TEST_ASSERT_EQUAL(q2_mpmc_get(&q2_mpmc_ctx2, &output), Q2_ERROR_EMPTY);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_mpmc_init_should_InitializeContext);
+    RUN_TEST(test_q2_mpmc_init_should_NotInitializeContext);
+    RUN_TEST(test_q2_mpmc_should_NotPutOrGet);
+    RUN_TEST(test_q2_mpmc_should_FillAndEmptyAcrossWrap);
+    RUN_TEST(test_q2_mpmc_should_DeliverEachItemOnceBetweenThreads);
+    return UNITY_END();
+}
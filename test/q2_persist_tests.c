@@ -0,0 +1,265 @@
+/**********************************************************
+ * Name:
+ *     q2_persist_tests.c
+ *
+ * Description:
+ *     Unity tests for file backed power of two queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_persist.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_CRASH_ITEM_COUNT (1000)
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static char test_path[64];
+static q2_persist_context_t test_queue;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    snprintf(test_path, sizeof(test_path), "/tmp/q2_persist_tests_%d", (int)getpid());
+    memset(&test_queue, 0x00, sizeof(test_queue));
+    unlink(test_path);
+}
+
+void tearDown(void)
+{
+    unlink(test_path);
+}
+
+void test_helper_q2_persist_corrupt(size_t offset)
+{
+    FILE* file = fopen(test_path, "r+b");
+    uint8_t byte;
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(0, fseek(file, (long)offset, SEEK_SET));
+    TEST_ASSERT_EQUAL(1, fread(&byte, 1, 1, file));
+    byte ^= 0xFF;
+    TEST_ASSERT_EQUAL(0, fseek(file, (long)offset, SEEK_SET));
+    TEST_ASSERT_EQUAL(1, fwrite(&byte, 1, 1, file));
+    fclose(file);
+}
+
+void test_q2_persist_open_should_CheckParameters(void)
+{
+    q2_persist_options_t options = { .flush = Q2_PERSIST_FLUSH_EVERY_N, .flush_interval = 0 };
+    uint32_t input = 0;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_persist_open(NULL, test_path, sizeof(uint32_t), 8, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, NULL, sizeof(uint32_t), 8, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 6, NULL), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, 0, 8, NULL), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, &options), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, "/nonexistent/q2", sizeof(uint32_t), 8, NULL), Q2_ERROR_ALLOCATION);
+
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &input), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_persist_flush(&test_queue), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_ERROR_NOT_INITIALIZED);
+
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_put(NULL, &input), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_flush(NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_close(NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &input), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+
+    /* Geometry must match on reopen */
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint64_t), 4, NULL), Q2_ERROR_INCOMPATIBLE);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint64_t), 8, NULL), Q2_ERROR_INCOMPATIBLE);
+}
+
+void test_q2_persist_should_KeepItemsAcrossReopen(void)
+{
+    q2_persist_options_t options = { .flush = Q2_PERSIST_FLUSH_EVERY_N, .flush_interval = 3 };
+    uint64_t input;
+    uint64_t output;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint64_t), 4, &options), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, ((uintptr_t)test_queue.data) % sysconf(_SC_PAGESIZE));
+
+    /* Wrap the ring once */
+    for(input = 0; input < 6; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+        if(input >= 2)
+        {
+            TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &output), Q2_SUCCESS);
+            TEST_ASSERT_EQUAL(input - 2, output);
+        }
+    }
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+    input++;
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint64_t), 4, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+    for(input = 4; input < 8; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &output), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_persist_flush(&test_queue), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+}
+
+void test_q2_persist_open_should_SkipTornCommit(void)
+{
+    uint32_t input = 7;
+    uint32_t length;
+    size_t commits = offsetof(q2_persist_header_t, commits);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_SUCCESS);
+
+    /* The empty commit is sequence 1, three puts end on sequence 4 in slot 0 */
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_put(&test_queue, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, test_queue.sequence);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+
+    /* A torn newest commit falls back to the one before it */
+    test_helper_q2_persist_corrupt(commits + offsetof(q2_persist_commit_t, head));
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, length);
+    TEST_ASSERT_EQUAL(3, test_queue.sequence);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+
+    /* With neither commit valid there is nothing to recover to */
+    test_helper_q2_persist_corrupt(commits + sizeof(q2_persist_commit_t) + offsetof(q2_persist_commit_t, tail));
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_ERROR_INCOMPATIBLE);
+
+    /* Nor with a damaged geometry */
+    unlink(test_path);
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+    test_helper_q2_persist_corrupt(offsetof(q2_persist_header_t, data_offset));
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 8, NULL), Q2_ERROR_INCOMPATIBLE);
+}
+
+void test_q2_persist_should_RecoverAfterProcessCrash(void)
+{
+    uint32_t input;
+    uint32_t output;
+    uint32_t length;
+    int status = -1;
+    pid_t child;
+
+    child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if(0 == child)
+    {
+        /* Never flushed nor closed, the page cache outlives the process */
+        if(Q2_SUCCESS != q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 2048, NULL))
+        {
+            _exit(1);
+        }
+        for(input = 0; input < TEST_CRASH_ITEM_COUNT; input++)
+        {
+            (void)q2_persist_put(&test_queue, &input);
+        }
+        for(input = 0; input < 100; input++)
+        {
+            (void)q2_persist_get(&test_queue, &output);
+        }
+        _exit(0);
+    }
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 2048, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(TEST_CRASH_ITEM_COUNT - 100, length);
+    for(input = 100; input < TEST_CRASH_ITEM_COUNT; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+}
+
+void test_q2_persist_should_CommitOnlyOnFlush(void)
+{
+    q2_persist_options_t options = { .flush = Q2_PERSIST_FLUSH_ON_DEMAND, .flush_interval = 0 };
+    uint32_t input;
+    uint32_t output;
+    uint32_t length;
+    int status = -1;
+    pid_t child;
+
+    child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if(0 == child)
+    {
+        if(Q2_SUCCESS != q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 4, &options))
+        {
+            _exit(1);
+        }
+
+        /* Puts stay out of the header until the flush */
+        for(input = 0; input < 4; input++)
+        {
+            (void)q2_persist_put(&test_queue, &input);
+        }
+        if(0 != test_queue.header->commits[test_queue.sequence & 1].head || Q2_SUCCESS != q2_persist_flush(&test_queue))
+        {
+            _exit(2);
+        }
+
+        /* Reusing the slot of item 0 commits its get first */
+        (void)q2_persist_get(&test_queue, &output);
+        (void)q2_persist_put(&test_queue, &input);
+        (void)q2_persist_get(&test_queue, &output);
+        _exit(0);
+    }
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+    /* Reopens at the commit made before the last put */
+    TEST_ASSERT_EQUAL(q2_persist_open(&test_queue, test_path, sizeof(uint32_t), 4, NULL), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_persist_length(&test_queue, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, length);
+    for(input = 1; input < 4; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_persist_get(&test_queue, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_persist_close(&test_queue), Q2_SUCCESS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_persist_open_should_CheckParameters);
+    RUN_TEST(test_q2_persist_should_KeepItemsAcrossReopen);
+    RUN_TEST(test_q2_persist_open_should_SkipTornCommit);
+    RUN_TEST(test_q2_persist_should_RecoverAfterProcessCrash);
+    RUN_TEST(test_q2_persist_should_CommitOnlyOnFlush);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+/**********************************************************
+ * Name:
+ *     q2_pool_tests.c
+ *
+ * Description:
+ *     Unity tests for thread pool built on q2 queues.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_pool.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_TASK_COUNT (20000)
+#define TEST_FAN_OUT (16)
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static _Atomic uint32_t test_ran;
+static _Atomic bool test_blocked;
+static _Atomic bool test_release;
+static q2_pool_t* test_pool;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    atomic_store(&test_ran, 0);
+    atomic_store(&test_blocked, false);
+    atomic_store(&test_release, false);
+    test_pool = NULL;
+}
+
+void test_helper_q2_pool_count(void* const arg)
+{
+    (void)arg;
+    atomic_fetch_add(&test_ran, 1);
+}
+
+void test_helper_q2_pool_fan_out(void* const arg)
+{
+    q2_task_t children[TEST_FAN_OUT];
+    uint32_t submitted = 0;
+    uint32_t total;
+    uint32_t i;
+    (void)arg;
+
+    for(i = 0; i < TEST_FAN_OUT; i++)
+    {
+        children[i].fn = test_helper_q2_pool_count;
+        children[i].arg = NULL;
+    }
+    (void)q2_pool_submit_n(test_pool, children, TEST_FAN_OUT, &submitted);
+
+    /* Waiting for room could deadlock when every worker is here, run the rest inline */
+    for(total = submitted; total < TEST_FAN_OUT; total++)
+    {
+        test_helper_q2_pool_count(NULL);
+    }
+    atomic_fetch_add(&test_ran, 1);
+}
+
+void test_helper_q2_pool_block(void* const arg)
+{
+    (void)arg;
+    atomic_store(&test_blocked, true);
+    while(false == atomic_load(&test_release))
+    {
+        sched_yield();
+    }
+    atomic_fetch_add(&test_ran, 1);
+}
+
+void test_helper_q2_pool_submit_all(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_TASK_COUNT; i++)
+    {
+        while(Q2_ERROR_FULL == q2_pool_submit(test_pool, test_helper_q2_pool_count, NULL))
+        {
+            sched_yield();
+        }
+    }
+}
+
+void test_q2_pool_create_should_CheckOptions(void)
+{
+    q2_pool_options_t options = { .worker_count = 2, .worker_length = 6, .submit_length = 8, .pinned = false };
+    TEST_ASSERT_EQUAL(q2_pool_create(NULL, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_NULL(test_pool);
+    options.worker_length = 8;
+    options.submit_length = 0;
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    options.submit_length = 8;
+    options.worker_count = Q2_POOL_MAX_WORKERS + 1;
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_destroy(NULL), Q2_ERROR_NULL_PARAMETER);
+
+    /* Defaults, one worker per cpu */
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, NULL), Q2_SUCCESS);
+    TEST_ASSERT_NOT_NULL(test_pool);
+    TEST_ASSERT_EQUAL(q2_pool_submit(test_pool, NULL, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_submit_n(test_pool, NULL, 1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_drain(NULL, 0), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_stats(test_pool, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_pool_destroy(test_pool), Q2_SUCCESS);
+}
+
+void test_q2_pool_should_RunEverySubmittedTask(void)
+{
+    q2_pool_options_t options = { .worker_count = 3, .worker_length = 64, .submit_length = 256, .pinned = true };
+    q2_pool_stats_t stats;
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_SUCCESS);
+
+    test_helper_q2_pool_submit_all();
+    TEST_ASSERT_EQUAL(q2_pool_drain(test_pool, Q2_WAIT_FOREVER), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(TEST_TASK_COUNT, atomic_load(&test_ran));
+
+    TEST_ASSERT_EQUAL(q2_pool_stats(test_pool, &stats), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(TEST_TASK_COUNT, stats.submitted);
+    TEST_ASSERT_EQUAL(TEST_TASK_COUNT, stats.executed);
+    TEST_ASSERT_EQUAL(0, stats.queued);
+    TEST_ASSERT_EQUAL(q2_pool_destroy(test_pool), Q2_SUCCESS);
+}
+
+void test_q2_pool_drain_should_WaitForNestedTasks(void)
+{
+    q2_pool_options_t options = { .worker_count = 4, .worker_length = 8, .submit_length = 64, .pinned = false };
+    q2_task_t tasks[32];
+    q2_pool_stats_t stats;
+    uint32_t submitted;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_SUCCESS);
+
+    /* Children overflow the worker deque of 8 onto the shared queue */
+    for(i = 0; i < 32; i++)
+    {
+        tasks[i].fn = test_helper_q2_pool_fan_out;
+        tasks[i].arg = NULL;
+    }
+    TEST_ASSERT_EQUAL(q2_pool_submit_n(test_pool, tasks, 32, &submitted), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(32, submitted);
+    TEST_ASSERT_EQUAL(q2_pool_drain(test_pool, Q2_WAIT_FOREVER), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(32 * (TEST_FAN_OUT + 1), atomic_load(&test_ran));
+
+    TEST_ASSERT_EQUAL(q2_pool_stats(test_pool, &stats), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(stats.submitted > 32);
+    TEST_ASSERT_EQUAL(stats.submitted, stats.executed);
+    TEST_ASSERT_EQUAL(q2_pool_destroy(test_pool), Q2_SUCCESS);
+}
+
+void test_q2_pool_should_ReportFullAndTimeOut(void)
+{
+    q2_pool_options_t options = { .worker_count = 1, .worker_length = 4, .submit_length = 2, .pinned = false };
+    q2_task_t tasks[4];
+    q2_pool_stats_t stats;
+    uint32_t submitted;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_SUCCESS);
+
+    /* Hold the only worker so the shared queue fills up */
+    TEST_ASSERT_EQUAL(q2_pool_submit(test_pool, test_helper_q2_pool_block, NULL), Q2_SUCCESS);
+    while(false == atomic_load(&test_blocked))
+    {
+        sched_yield();
+    }
+    for(i = 0; i < 4; i++)
+    {
+        tasks[i].fn = test_helper_q2_pool_count;
+        tasks[i].arg = NULL;
+    }
+    TEST_ASSERT_EQUAL(q2_pool_submit_n(test_pool, tasks, 4, &submitted), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, submitted);
+    TEST_ASSERT_EQUAL(q2_pool_submit(test_pool, test_helper_q2_pool_count, NULL), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_pool_stats(test_pool, &stats), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, stats.submitted);
+    TEST_ASSERT_EQUAL(2, stats.queued);
+    TEST_ASSERT_EQUAL(q2_pool_drain(test_pool, 1000), Q2_ERROR_TIMEOUT);
+
+    atomic_store(&test_release, true);
+    TEST_ASSERT_EQUAL(q2_pool_drain(test_pool, Q2_WAIT_FOREVER), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, atomic_load(&test_ran));
+    TEST_ASSERT_EQUAL(q2_pool_destroy(test_pool), Q2_SUCCESS);
+}
+
+void test_q2_pool_destroy_should_RunQueuedTasks(void)
+{
+    q2_pool_options_t options = { .worker_count = 2, .worker_length = 16, .submit_length = 1024, .pinned = false };
+    TEST_ASSERT_EQUAL(q2_pool_create(&test_pool, &options), Q2_SUCCESS);
+
+    test_helper_q2_pool_submit_all();
+    TEST_ASSERT_EQUAL(q2_pool_destroy(test_pool), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(TEST_TASK_COUNT, atomic_load(&test_ran));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_pool_create_should_CheckOptions);
+    RUN_TEST(test_q2_pool_should_RunEverySubmittedTask);
+    RUN_TEST(test_q2_pool_drain_should_WaitForNestedTasks);
+    RUN_TEST(test_q2_pool_should_ReportFullAndTimeOut);
+    RUN_TEST(test_q2_pool_destroy_should_RunQueuedTasks);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+/**********************************************************
+ * Name:
+ *     q2_prio_tests.c
+ *
+ * Description:
+ *     Unity tests for multi level priority queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_prio.h"
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_PRIO(q2_prio_ctx1, uint32_t, 4, 64);
+Q2_PRIO(q2_prio_ctx2, uint32_t, 8, 3);
+
+// Invalid initializers (not power of two, too many levels)
+Q2_PRIO(q2_prio_ctx3, uint32_t, 6, 2);
+Q2_PRIO(q2_prio_ctx4, uint32_t, 4, 65);
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    q2_prio_ctx1.initialized = false;
+    q2_prio_ctx2.initialized = false;
+}
+
+void test_q2_prio_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx4), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_prio_should_NotPutOrGet(void)
+{
+    uint32_t item = 0;
+    uint32_t level;
+    uint32_t count;
+    TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx2, 0, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx2, &item, &level), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_prio_get_n(&q2_prio_ctx2, &item, 1, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_prio_length(&q2_prio_ctx2, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_prio_put(NULL, 0, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx2, 0, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx2, 3, &item), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx2, &item, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_get_n(&q2_prio_ctx2, NULL, 1, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_length(&q2_prio_ctx2, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx2, &item, &level), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_prio_get_n(&q2_prio_ctx2, &item, 1, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_q2_prio_should_GetHighestLevelFirst(void)
+{
+    uint32_t input;
+    uint32_t output;
+    uint32_t level;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx1), Q2_SUCCESS);
+
+    /* One item on every level, lowest first */
+    for(input = 0; input < 64; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx1, input, &input), Q2_SUCCESS);
+    }
+    input = 1000;
+    TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx1, 63, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_prio_length(&q2_prio_ctx1, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(65, length);
+
+    /* FIFO within a level */
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx1, &output, &level), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(63, level);
+    TEST_ASSERT_EQUAL(63, output);
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx1, &output, &level), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(63, level);
+    TEST_ASSERT_EQUAL(1000, output);
+
+    for(input = 63; input > 0; input--)
+    {
+        TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx1, &output, &level), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input - 1, level);
+        TEST_ASSERT_EQUAL(input - 1, output);
+    }
+    TEST_ASSERT_EQUAL(q2_prio_get(&q2_prio_ctx1, &output, &level), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, q2_prio_ctx1.occupied);
+}
+
+void test_q2_prio_get_n_should_DrainAcrossLevels(void)
+{
+    uint32_t input;
+    uint32_t output[16];
+    uint32_t count;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_prio_init(&q2_prio_ctx2), Q2_SUCCESS);
+
+    /* Level n holds items 10 * n .. 10 * n + 2 */
+    for(input = 0; input < 9; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_prio_put(&q2_prio_ctx2, input / 3, &(uint32_t){ (10 * (input / 3)) + (input % 3) }), Q2_SUCCESS);
+    }
+
+    TEST_ASSERT_EQUAL(q2_prio_get_n(&q2_prio_ctx2, output, 4, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, count);
+    TEST_ASSERT_EQUAL(20, output[0]);
+    TEST_ASSERT_EQUAL(21, output[1]);
+    TEST_ASSERT_EQUAL(22, output[2]);
+    TEST_ASSERT_EQUAL(10, output[3]);
+    TEST_ASSERT_EQUAL(0x3, q2_prio_ctx2.occupied);
+
+    TEST_ASSERT_EQUAL(q2_prio_get_n(&q2_prio_ctx2, output, 16, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(5, count);
+    TEST_ASSERT_EQUAL(11, output[0]);
+    TEST_ASSERT_EQUAL(12, output[1]);
+    TEST_ASSERT_EQUAL(0, output[2]);
+    TEST_ASSERT_EQUAL(2, output[4]);
+    TEST_ASSERT_EQUAL(q2_prio_length(&q2_prio_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, length);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_prio_init_should_InitializeContext);
+    RUN_TEST(test_q2_prio_should_NotPutOrGet);
+    RUN_TEST(test_q2_prio_should_GetHighestLevelFirst);
+    RUN_TEST(test_q2_prio_get_n_should_DrainAcrossLevels);
+    return UNITY_END();
+}
@@ -0,0 +1,257 @@
+/**********************************************************
+ * Name:
+ *     q2_qset_tests.c
+ *
+ * Description:
+ *     Unity tests for queue sets.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_qset.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_QUEUE_COUNT (70)
+#define TEST_QUEUE_SIZE (4)
+#define TEST_THREADED_ITEM_COUNT (100000)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_QSET(q2_qset_set1, TEST_QUEUE_COUNT);
+Q2_QSET(q2_qset_set2, 1);
+Q2_QSET(q2_qset_set4, 2);
+
+// Invalid size initializer (no members)
+Q2_QSET(q2_qset_set3, 0);
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static uint32_t test_queue_array[TEST_QUEUE_COUNT][TEST_QUEUE_SIZE];
+static q2_spsc_context_t test_queues[TEST_QUEUE_COUNT];
+static uint32_t test_pair_array[2][TEST_QUEUE_SIZE];
+static q2_spsc_context_t test_pair[2];
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    uint32_t i;
+    uint32_t index;
+
+    memset(test_queues, 0x00, sizeof(test_queues));
+    TEST_ASSERT_EQUAL(q2_qset_init(&q2_qset_set1), Q2_SUCCESS);
+    for(i = 0; i < TEST_QUEUE_COUNT; i++)
+    {
+        test_queues[i].data = test_queue_array[i];
+        test_queues[i].max_length = TEST_QUEUE_SIZE;
+        test_queues[i].item_length = sizeof(uint32_t);
+        TEST_ASSERT_EQUAL(q2_spsc_init(&test_queues[i]), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set1, &test_queues[i], &index), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(i, index);
+    }
+}
+
+void* test_helper_q2_qset_producer(void* arg)
+{
+    uint32_t input;
+    (void)arg;
+
+    /* Spread items over queues in both bitmap words */
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        while(Q2_SUCCESS != q2_spsc_put(&test_queues[(input % 2) * 67], &input))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_qset_init_should_InitializeSet(void)
+{
+    uint32_t index;
+    TEST_ASSERT_EQUAL(q2_qset_init(&q2_qset_set2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_qset_init(&q2_qset_set3), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_init(NULL), Q2_ERROR_NULL_PARAMETER);
+
+    /* Full set and a queue that already belongs to a set */
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set1, &test_queues[0], &index), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_init(&test_queues[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set1, &test_queues[0], &index), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set2, &test_queues[0], &index), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, index);
+    TEST_ASSERT_EQUAL_PTR(&q2_qset_set2, test_queues[0].qset);
+}
+
+void test_q2_qset_should_NotAddOrPoll(void)
+{
+    uint32_t ready[4];
+    uint32_t count;
+    uint32_t index;
+    q2_qset_set2.initialized = false;
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set2, &test_queues[0], &index), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set2, ready, 4, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_qset_add(NULL, &test_queues[0], &index), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set1, NULL, &index), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set1, &test_queues[0], NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, NULL, 4, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_q2_qset_poll_should_ReturnOnlyReadyQueues(void)
+{
+    uint32_t input = 7;
+    uint32_t output;
+    uint32_t ready[4];
+    uint32_t count;
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[3], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[3], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[65], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0x8, q2_qset_set1.ready[0]);
+    TEST_ASSERT_EQUAL(0x2, q2_qset_set1.ready[1]);
+
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(3, ready[0]);
+    TEST_ASSERT_EQUAL(65, ready[1]);
+
+    /* Drained queues drop out and their bits are cleared */
+    TEST_ASSERT_EQUAL(q2_spsc_get(&test_queues[65], &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&test_queues[3], &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(3, ready[0]);
+    TEST_ASSERT_EQUAL(0, q2_qset_set1.ready[1]);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&test_queues[3], &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, q2_qset_set1.ready[0]);
+
+    /* With room for one index the scan alternates between bitmap words */
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[1], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[69], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 1, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, count);
+    output = ready[0];
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 1, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(70, output + ready[0]);
+}
+
+void test_q2_qset_poll_should_NotStarveQueuesInOneWord(void)
+{
+    uint32_t input = 7;
+    uint32_t ready[1];
+    uint32_t served[2] = { 0, 0 };
+    uint32_t count;
+    uint32_t index;
+    uint32_t i;
+    memset(test_pair, 0x00, sizeof(test_pair));
+    TEST_ASSERT_EQUAL(q2_qset_init(&q2_qset_set4), Q2_SUCCESS);
+    for(i = 0; i < 2; i++)
+    {
+        test_pair[i].data = test_pair_array[i];
+        test_pair[i].max_length = TEST_QUEUE_SIZE;
+        test_pair[i].item_length = sizeof(uint32_t);
+        TEST_ASSERT_EQUAL(q2_spsc_init(&test_pair[i]), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(q2_qset_add(&q2_qset_set4, &test_pair[i], &index), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(q2_spsc_put(&test_pair[i], &input), Q2_SUCCESS);
+    }
+
+    /* Both stay ready, room for one index must still take turns */
+    for(i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set4, ready, 1, &count), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(1, count);
+        served[ready[0]]++;
+    }
+    TEST_ASSERT_EQUAL(5, served[0]);
+    TEST_ASSERT_EQUAL(5, served[1]);
+}
+
+void test_q2_qset_wait_should_WakeOnAnyQueue(void)
+{
+    pthread_t producer;
+    uint32_t ready[2];
+    uint32_t count;
+    uint32_t output;
+    uint32_t expected = 0;
+    uint32_t i;
+    bool ordered = true;
+    TEST_ASSERT_EQUAL(q2_qset_wait(&q2_qset_set1, ready, 2, &count, 1000), Q2_ERROR_TIMEOUT);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_qset_producer, NULL), 0);
+
+    /* Items alternate between the two queues, so reading both keeps order */
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        TEST_ASSERT_EQUAL(q2_qset_wait(&q2_qset_set1, ready, 2, &count, Q2_WAIT_FOREVER), Q2_SUCCESS);
+        for(i = 0; i < count; i++)
+        {
+            TEST_ASSERT_TRUE(0 == ready[i] || 67 == ready[i]);
+        }
+        while(Q2_SUCCESS == q2_spsc_get(&test_queues[(expected % 2) * 67], &output))
+        {
+            if(expected != output)
+            {
+                ordered = false;
+            }
+            expected++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(ordered);
+}
+
+void test_q2_qset_eventfd_should_BecomeReadable(void)
+{
+    uint32_t input = 1;
+    uint32_t ready[4];
+    uint32_t count;
+    uint64_t value = 0;
+    int fd = -1;
+    TEST_ASSERT_EQUAL(q2_qset_eventfd(&q2_qset_set1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_qset_eventfd(&q2_qset_set1, &fd), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(-1, read(fd, &value, sizeof(value)));
+
+    /* Only the empty to non-empty transition signals */
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[10], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[10], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&test_queues[20], &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(sizeof(value), read(fd, &value, sizeof(value)));
+    TEST_ASSERT_EQUAL(2, value);
+    TEST_ASSERT_EQUAL(q2_qset_poll(&q2_qset_set1, ready, 4, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, count);
+
+    TEST_ASSERT_EQUAL(q2_qset_eventfd_close(&q2_qset_set1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(-1, q2_qset_set1.eventfd);
+    TEST_ASSERT_EQUAL(q2_qset_eventfd_close(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_qset_init_should_InitializeSet);
+    RUN_TEST(test_q2_qset_should_NotAddOrPoll);
+    RUN_TEST(test_q2_qset_poll_should_ReturnOnlyReadyQueues);
+    RUN_TEST(test_q2_qset_poll_should_NotStarveQueuesInOneWord);
+    RUN_TEST(test_q2_qset_wait_should_WakeOnAnyQueue);
+    RUN_TEST(test_q2_qset_eventfd_should_BecomeReadable);
+    return UNITY_END();
+}
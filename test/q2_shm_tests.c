@@ -0,0 +1,168 @@
+/**********************************************************
+ * Name:
+ *     q2_shm_tests.c
+ *
+ * Description:
+ *     Unity tests for power of two queue shared between
+ *     processes.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_shm.h"
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_PROCESS_ITEM_COUNT (100000)
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static char test_name[64];
+static q2_shm_context_t test_producer;
+static q2_shm_context_t test_consumer;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    snprintf(test_name, sizeof(test_name), "/q2_shm_tests_%d", (int)getpid());
+    memset(&test_producer, 0x00, sizeof(test_producer));
+    memset(&test_consumer, 0x00, sizeof(test_consumer));
+}
+
+void tearDown(void)
+{
+    shm_unlink(test_name);
+}
+
+int test_helper_q2_shm_consumer_process(void)
+{
+    uint64_t expected;
+    uint64_t output;
+    int status = 0;
+
+    while(Q2_SUCCESS != q2_shm_attach(&test_consumer, test_name, sizeof(uint64_t), 64))
+    {
+        sched_yield();
+    }
+
+    for(expected = 0; expected < TEST_PROCESS_ITEM_COUNT; expected++)
+    {
+        while(Q2_SUCCESS != q2_shm_get(&test_consumer, &output))
+        {
+            sched_yield();
+        }
+        if(expected != output)
+        {
+            status = 1;
+        }
+    }
+
+    q2_shm_detach(&test_consumer);
+    return status;
+}
+
+void test_q2_shm_should_PutAndGetThroughRegion(void)
+{
+    uint32_t input;
+    uint32_t output;
+    uint32_t length;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, test_name, sizeof(uint32_t), 4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)test_producer.data % Q2_CACHE_LINE_SIZE);
+
+    for(i = 0; i < 4; i++)
+    {
+        input = 0x1000 + i;
+        TEST_ASSERT_EQUAL(q2_shm_put(&test_producer, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_shm_put(&test_producer, &input), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_shm_length(&test_consumer, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_shm_get(&test_consumer, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(0x1000 + i, output);
+    }
+    TEST_ASSERT_EQUAL(q2_shm_get(&test_consumer, &output), Q2_ERROR_EMPTY);
+
+    TEST_ASSERT_EQUAL(q2_shm_detach(&test_consumer), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_shm_detach(&test_producer), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_ERROR_ALLOCATION);
+}
+
+void test_q2_shm_should_NotCreateOrAttach(void)
+{
+    uint32_t item = 0;
+    TEST_ASSERT_EQUAL(q2_shm_create(NULL, test_name, sizeof(uint32_t), 4), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, NULL, sizeof(uint32_t), 4), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, test_name, sizeof(uint32_t), 6), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, test_name, 0, 4), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_shm_put(&test_producer, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_shm_get(&test_producer, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_shm_detach(&test_producer), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_ERROR_ALLOCATION);
+
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, test_name, sizeof(uint32_t), 4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_ERROR_ALLOCATION);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint64_t), 4), Q2_ERROR_INCOMPATIBLE);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 8), Q2_ERROR_INCOMPATIBLE);
+
+    test_producer.header->version = Q2_SHM_VERSION + 1;
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_ERROR_INCOMPATIBLE);
+    test_producer.header->version = Q2_SHM_VERSION;
+    atomic_store(&test_producer.header->magic, 0);
+    TEST_ASSERT_EQUAL(q2_shm_attach(&test_consumer, test_name, sizeof(uint32_t), 4), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_shm_detach(&test_producer), Q2_SUCCESS);
+}
+
+void test_q2_shm_should_TransferInOrderBetweenProcesses(void)
+{
+    pid_t consumer;
+    uint64_t input;
+    int status = -1;
+    TEST_ASSERT_EQUAL(q2_shm_create(&test_producer, test_name, sizeof(uint64_t), 64), Q2_SUCCESS);
+
+    consumer = fork();
+    if(0 == consumer)
+    {
+        _exit(test_helper_q2_shm_consumer_process());
+    }
+    TEST_ASSERT_TRUE(consumer > 0);
+
+    for(input = 0; input < TEST_PROCESS_ITEM_COUNT; input++)
+    {
+        while(Q2_ERROR_FULL == q2_shm_put(&test_producer, &input))
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(waitpid(consumer, &status, 0), consumer);
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+    TEST_ASSERT_EQUAL(q2_shm_detach(&test_producer), Q2_SUCCESS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_shm_should_PutAndGetThroughRegion);
+    RUN_TEST(test_q2_shm_should_NotCreateOrAttach);
+    RUN_TEST(test_q2_shm_should_TransferInOrderBetweenProcesses);
+    return UNITY_END();
+}
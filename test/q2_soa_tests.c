@@ -0,0 +1,272 @@
+/**********************************************************
+ * Name:
+ *     q2_soa_tests.c
+ *
+ * Description:
+ *     Unity tests for structure-of-arrays queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_soa.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (100000)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    uint64_t timestamp;
+    uint8_t  flags;
+    double   price;
+    uint32_t volume;
+} test_tick_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_SOA(q2_soa_ctx1, test_tick_t, 8,
+       Q2_SOA_FIELD(test_tick_t, timestamp),
+       Q2_SOA_FIELD(test_tick_t, price),
+       Q2_SOA_FIELD(test_tick_t, volume));
+Q2_SOA(q2_soa_ctx2, test_tick_t, 64,
+       Q2_SOA_FIELD(test_tick_t, timestamp),
+       Q2_SOA_FIELD(test_tick_t, volume));
+
+// Invalid size initializer (not power of two)
+Q2_SOA(q2_soa_ctx3, test_tick_t, 12,
+       Q2_SOA_FIELD(test_tick_t, volume));
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    q2_soa_ctx1.initialized = false;
+    q2_soa_ctx2.initialized = false;
+    q2_soa_ctx3.initialized = false;
+}
+
+void test_helper_q2_soa_tick(test_tick_t* const tick, uint32_t i)
+{
+    memset(tick, 0x00, sizeof(*tick));
+    tick->timestamp = 1000 + i;
+    tick->flags = 0xAA;
+    tick->price = 0.5 * i;
+    tick->volume = i;
+}
+
+void* test_helper_q2_soa_producer(void* arg)
+{
+    test_tick_t ticks[16];
+    uint32_t sent = 0;
+    uint32_t transferred;
+    uint32_t i;
+    (void)arg;
+
+    while(sent < TEST_THREADED_ITEM_COUNT)
+    {
+        for(i = 0; i < 16; i++)
+        {
+            test_helper_q2_soa_tick(&ticks[i], sent + i);
+        }
+        if(Q2_SUCCESS == q2_soa_put_n(&q2_soa_ctx2, ticks, 16, &transferred))
+        {
+            sent += transferred;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_soa_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_soa_init(NULL), Q2_ERROR_NULL_PARAMETER);
+
+    /* Each column starts on its own cache line */
+    TEST_ASSERT_EQUAL_PTR(q2_soa_ctx1.data, q2_soa_ctx1.columns[0]);
+    TEST_ASSERT_EQUAL(0, ((uintptr_t)q2_soa_ctx1.columns[1]) % Q2_CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL(0, ((uintptr_t)q2_soa_ctx1.columns[2]) % Q2_CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL(64, q2_soa_ctx1.columns[1] - q2_soa_ctx1.columns[0]);
+
+    /* A field that runs past the record */
+    q2_soa_ctx2.record_length = 8;
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx2), Q2_ERROR_INVALID_PARAMETER);
+    q2_soa_ctx2.record_length = sizeof(test_tick_t);
+}
+
+void test_q2_soa_should_NotPutOrGet(void)
+{
+    test_tick_t tick = { 0 };
+    void* spans[3];
+    uint32_t count;
+    TEST_ASSERT_EQUAL(q2_soa_put(&q2_soa_ctx1, &tick), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, &tick, 1, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_get(&q2_soa_ctx1, &tick), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 1, spans, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 0), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_length(&q2_soa_ctx1, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_put(NULL, &tick), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_put(&q2_soa_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, &tick, 1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_get(&q2_soa_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 1, NULL, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_release(NULL, 0), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_length(&q2_soa_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_soa_get(&q2_soa_ctx1, &tick), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 1, spans, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, count);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 1), Q2_ERROR_EMPTY);
+}
+
+void test_q2_soa_should_SplitAndGatherRecords(void)
+{
+    test_tick_t input[8];
+    test_tick_t output;
+    uint32_t transferred;
+    uint32_t length;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx1), Q2_SUCCESS);
+
+    for(i = 0; i < 8; i++)
+    {
+        test_helper_q2_soa_tick(&input[i], i);
+    }
+    TEST_ASSERT_EQUAL(q2_soa_put(&q2_soa_ctx1, &input[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, &input[1], 8, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(7, transferred);
+    TEST_ASSERT_EQUAL(q2_soa_put(&q2_soa_ctx1, &input[0]), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, input, 1, &transferred), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(0, transferred);
+    TEST_ASSERT_EQUAL(q2_soa_length(&q2_soa_ctx1, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(8, length);
+
+    /* The volume column is packed */
+    TEST_ASSERT_EQUAL(5, ((uint32_t*)q2_soa_ctx1.columns[2])[5]);
+
+    /* Only the fields are written back */
+    for(i = 0; i < 8; i++)
+    {
+        memset(&output, 0x00, sizeof(output));
+        TEST_ASSERT_EQUAL(q2_soa_get(&q2_soa_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(1000 + i, output.timestamp);
+        TEST_ASSERT_TRUE(0.5 * i == output.price);
+        TEST_ASSERT_EQUAL(i, output.volume);
+        TEST_ASSERT_EQUAL(0, output.flags);
+    }
+    TEST_ASSERT_EQUAL(q2_soa_get(&q2_soa_ctx1, &output), Q2_ERROR_EMPTY);
+}
+
+void test_q2_soa_peek_should_ReturnColumnSpansUpToWrap(void)
+{
+    test_tick_t input[8];
+    void* spans[3];
+    uint64_t* timestamps;
+    double* prices;
+    uint32_t* volumes;
+    uint32_t transferred;
+    uint32_t available;
+    uint32_t sum = 0;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx1), Q2_SUCCESS);
+
+    /* Move head and tail to two records before the wrap */
+    for(i = 0; i < 8; i++)
+    {
+        test_helper_q2_soa_tick(&input[i], i);
+    }
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, input, 6, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 6), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_put_n(&q2_soa_ctx1, input, 5, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(5, transferred);
+
+    /* 2 records before the wrap, 3 after */
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 8, spans, &available), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, available);
+    timestamps = spans[0];
+    prices = spans[1];
+    TEST_ASSERT_EQUAL(1000, timestamps[0]);
+    TEST_ASSERT_TRUE(0.5 == prices[1]);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 2), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 8, spans, &available), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, available);
+    TEST_ASSERT_EQUAL_PTR(q2_soa_ctx1.columns[2], spans[2]);
+    volumes = spans[2];
+    for(i = 0; i < available; i++)
+    {
+        sum += volumes[i];
+    }
+    TEST_ASSERT_EQUAL(2 + 3 + 4, sum);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 4), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx1, 3), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_soa_peek(&q2_soa_ctx1, 8, spans, &available), Q2_ERROR_EMPTY);
+}
+
+void test_q2_soa_should_KeepOrderAcrossThreads(void)
+{
+    pthread_t producer;
+    void* spans[2];
+    uint64_t* timestamps;
+    uint32_t* volumes;
+    uint32_t available;
+    uint32_t expected = 0;
+    uint32_t i;
+    bool ordered = true;
+    TEST_ASSERT_EQUAL(q2_soa_init(&q2_soa_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_soa_producer, NULL), 0);
+
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_soa_peek(&q2_soa_ctx2, 32, spans, &available))
+        {
+            timestamps = spans[0];
+            volumes = spans[1];
+            for(i = 0; i < available; i++)
+            {
+                if(expected != volumes[i] || (1000 + expected) != timestamps[i])
+                {
+                    ordered = false;
+                }
+                expected++;
+            }
+            TEST_ASSERT_EQUAL(q2_soa_release(&q2_soa_ctx2, available), Q2_SUCCESS);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(ordered);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_soa_init_should_InitializeContext);
+    RUN_TEST(test_q2_soa_should_NotPutOrGet);
+    RUN_TEST(test_q2_soa_should_SplitAndGatherRecords);
+    RUN_TEST(test_q2_soa_peek_should_ReturnColumnSpansUpToWrap);
+    RUN_TEST(test_q2_soa_should_KeepOrderAcrossThreads);
+    return UNITY_END();
+}
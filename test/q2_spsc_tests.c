@@ -0,0 +1,450 @@
+/**********************************************************
+ * Name:
+ *     q2_spsc_tests.c
+ *
+ * Description:
+ *     Unity tests for lock-free single producer, single
+ *     consumer power of two queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_spsc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_ITEM_COUNT (1000000)
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    _Atomic uint32_t running;
+    _Atomic bool alternating;
+    bool last_high;
+    uint32_t calls;
+} test_watermark_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_SPSC(q2_spsc_ctx1, uint32_t, 4);
+Q2_SPSC(q2_spsc_ctx2, uint64_t, 256);
+Q2_SPSC(q2_spsc_ctx4, uint64_t, 8);
+
+// Invalid size initializer (not power of two)
+Q2_SPSC(q2_spsc_ctx3, uint32_t, 3);
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_spsc_context_clear(q2_spsc_context_t* const ctx)
+{
+    memset(ctx->data, 0x00, ctx->item_length * ctx->max_length);
+    ctx->initialized = false;
+}
+
+void setUp(void)
+{
+    test_helper_q2_spsc_context_clear(&q2_spsc_ctx1);
+    test_helper_q2_spsc_context_clear(&q2_spsc_ctx2);
+    test_helper_q2_spsc_context_clear(&q2_spsc_ctx3);
+    test_helper_q2_spsc_context_clear(&q2_spsc_ctx4);
+}
+
+void* test_helper_q2_spsc_producer(void* arg)
+{
+    q2_spsc_context_t* ctx = arg;
+    uint64_t input;
+
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        while(Q2_ERROR_FULL == q2_spsc_put(ctx, &input))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void* test_helper_q2_spsc_waiting_producer(void* arg)
+{
+    q2_spsc_context_t* ctx = arg;
+    uint64_t input;
+
+    for(input = 0; input < TEST_THREADED_ITEM_COUNT; input++)
+    {
+        (void)q2_spsc_put_wait(ctx, &input, Q2_WAIT_FOREVER);
+    }
+
+    return NULL;
+}
+
+bool test_helper_q2_spsc_drain_check(void* const item, void* const arg)
+{
+    uint64_t* expected = arg;
+    bool in_order = (*expected == *(uint64_t*)item);
+
+    *expected += 1;
+
+    return in_order;
+}
+
+void test_helper_q2_spsc_watermark_count(bool high, void* const arg)
+{
+    uint32_t* crossings = arg;
+
+    crossings[(true == high) ? 1 : 0]++;
+}
+
+void test_helper_q2_spsc_watermark_alternate(bool high, void* const arg)
+{
+    test_watermark_t* watermark = arg;
+
+    if(0 != atomic_fetch_add(&watermark->running, 1) || high == watermark->last_high)
+    {
+        atomic_store(&watermark->alternating, false);
+    }
+    watermark->last_high = high;
+    watermark->calls++;
+
+    /* Give the other side a chance to signal while this one runs */
+    sched_yield();
+    atomic_fetch_sub(&watermark->running, 1);
+}
+
+uint64_t test_helper_now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000ull) + ((uint64_t)now.tv_nsec / 1000ull);
+}
+
+void test_q2_spsc_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx1), Q2_SUCCESS);
+}
+
+void test_q2_spsc_init_should_NotInitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_spsc_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_spsc_should_NotPutOrGet(void)
+{
+    uint32_t item = 0x12345678;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &item), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_length(&q2_spsc_ctx1, &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_get(NULL, &item), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_length(&q2_spsc_ctx1, NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_spsc_should_FillAndEmptyAcrossWrap(void)
+{
+    uint32_t input = 0;
+    uint32_t output;
+    uint32_t length;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx1), Q2_SUCCESS);
+
+    /* Go around the ring several times to exercise the free running indices */
+    for(i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &output), Q2_ERROR_EMPTY);
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &input), Q2_SUCCESS);
+        input++;
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &input), Q2_SUCCESS);
+        input++;
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &input), Q2_SUCCESS);
+        input++;
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &input), Q2_SUCCESS);
+        input++;
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx1, &input), Q2_ERROR_FULL);
+        TEST_ASSERT_EQUAL(q2_spsc_length(&q2_spsc_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(4, length);
+
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input - 4, output);
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input - 3, output);
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input - 2, output);
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx1, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input - 1, output);
+        TEST_ASSERT_EQUAL(q2_spsc_length(&q2_spsc_ctx1, &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(0, length);
+    }
+}
+
+void test_q2_spsc_should_TransferInOrderBetweenThreads(void)
+{
+    pthread_t producer;
+    uint64_t expected = 0;
+    uint64_t output;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_spsc_producer, &q2_spsc_ctx2), 0);
+
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_spsc_get(&q2_spsc_ctx2, &output))
+        {
+            if(expected != output)
+            {
+                in_order = false;
+            }
+            expected++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx2, &output), Q2_ERROR_EMPTY);
+}
+
+void test_q2_spsc_drain_should_TransferInOrderBetweenThreads(void)
+{
+    pthread_t producer;
+    uint64_t expected = 0;
+    uint32_t drained;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx2, test_helper_q2_spsc_drain_check, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx2, NULL, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx2, test_helper_q2_spsc_drain_check, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx2, test_helper_q2_spsc_drain_check, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_spsc_producer, &q2_spsc_ctx2), 0);
+
+    /* Batches of at most 32 items, the handler stops on the first item out of order */
+    while(expected < TEST_THREADED_ITEM_COUNT && true == in_order)
+    {
+        if(Q2_SUCCESS == q2_spsc_drain(&q2_spsc_ctx2, test_helper_q2_spsc_drain_check, &expected, 32, Q2_NO_LIMIT, &drained))
+        {
+            TEST_ASSERT_TRUE(drained <= 32);
+            in_order = (0 != drained && expected <= TEST_THREADED_ITEM_COUNT);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_EQUAL(TEST_THREADED_ITEM_COUNT, expected);
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx2, test_helper_q2_spsc_drain_check, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_EMPTY);
+}
+
+void test_q2_spsc_wait_should_TimeOut(void)
+{
+    uint32_t item = 0x12345678;
+    uint32_t i;
+    uint64_t start;
+    TEST_ASSERT_EQUAL(q2_spsc_put_wait(NULL, &item, 0), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx1, &item, 0), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_wait_enable(&q2_spsc_ctx1), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put_wait(&q2_spsc_ctx1, &item, 0), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx1, &item, 0), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_wait_enable(NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_wait_enable(&q2_spsc_ctx1), Q2_SUCCESS);
+
+    start = test_helper_now_us();
+    TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx1, &item, 2000), Q2_ERROR_TIMEOUT);
+    TEST_ASSERT_GREATER_OR_EQUAL(2000, test_helper_now_us() - start);
+
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_put_wait(&q2_spsc_ctx1, &item, 0), Q2_SUCCESS);
+    }
+    start = test_helper_now_us();
+    TEST_ASSERT_EQUAL(q2_spsc_put_wait(&q2_spsc_ctx1, &item, 2000), Q2_ERROR_TIMEOUT);
+    TEST_ASSERT_GREATER_OR_EQUAL(2000, test_helper_now_us() - start);
+    TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx1, &item, 0), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0x12345678, item);
+}
+
+void test_q2_spsc_wait_should_TransferInOrderBetweenThreads(void)
+{
+    pthread_t producer;
+    uint64_t expected;
+    uint64_t output;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_wait_enable(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_spsc_waiting_producer, &q2_spsc_ctx4), 0);
+
+    for(expected = 0; expected < TEST_THREADED_ITEM_COUNT; expected++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx4, &output, Q2_WAIT_FOREVER), Q2_SUCCESS);
+        if(expected != output)
+        {
+            in_order = false;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+}
+
+void test_q2_spsc_wait_should_WakeOnPlainPut(void)
+{
+    pthread_t producer;
+    uint64_t expected;
+    uint64_t output;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_wait_enable(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_spsc_producer, &q2_spsc_ctx4), 0);
+
+    /* The producer never waits, its plain puts must still wake the parked consumer */
+    for(expected = 0; expected < TEST_THREADED_ITEM_COUNT; expected++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_get_wait(&q2_spsc_ctx4, &output, Q2_WAIT_FOREVER), Q2_SUCCESS);
+        if(expected != output)
+        {
+            in_order = false;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+}
+
+void test_q2_spsc_watermark_should_NotSetWatermark(void)
+{
+    uint32_t crossings[2] = { 0, 0 };
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 6, 2, test_helper_q2_spsc_watermark_count, crossings), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(NULL, 6, 2, test_helper_q2_spsc_watermark_count, crossings), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 0, 0, test_helper_q2_spsc_watermark_count, crossings), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 9, 2, test_helper_q2_spsc_watermark_count, crossings), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 4, 4, test_helper_q2_spsc_watermark_count, crossings), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 8, 7, test_helper_q2_spsc_watermark_count, crossings), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 0, 0, NULL, NULL), Q2_SUCCESS);
+}
+
+void test_q2_spsc_watermark_should_SignalOncePerCrossing(void)
+{
+    uint32_t crossings[2] = { 0, 0 };
+    uint64_t input = 0;
+    uint64_t output;
+    uint64_t expected = 0;
+    uint32_t drained;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 6, 2, test_helper_q2_spsc_watermark_count, crossings), Q2_SUCCESS);
+
+    /* Nothing until the high mark, then once however long it stays above */
+    for(i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(0, crossings[1]);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, crossings[1]);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(1, crossings[1]);
+
+    /* Dropping between the marks and refilling signals nothing */
+    for(i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, crossings[1]);
+    TEST_ASSERT_EQUAL(0, crossings[0]);
+
+    /* Low fires once at the low mark */
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, crossings[0]);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, crossings[0]);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_get(&q2_spsc_ctx4, &output), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(1, crossings[0]);
+
+    /* A drain reports the next low crossing */
+    for(i = 0; i < 7; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_spsc_put(&q2_spsc_ctx4, &input), Q2_SUCCESS);
+        input++;
+    }
+    TEST_ASSERT_EQUAL(2, crossings[1]);
+    TEST_ASSERT_EQUAL(q2_spsc_drain(&q2_spsc_ctx4, test_helper_q2_spsc_drain_check, &expected, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(7, drained);
+    TEST_ASSERT_EQUAL(2, crossings[0]);
+    TEST_ASSERT_EQUAL(2, crossings[1]);
+}
+
+void test_q2_spsc_watermark_should_AlternateBetweenThreads(void)
+{
+    test_watermark_t watermark = { .running = 0, .alternating = true, .last_high = false, .calls = 0 };
+    pthread_t producer;
+    uint64_t expected = 0;
+    uint64_t output;
+    TEST_ASSERT_EQUAL(q2_spsc_init(&q2_spsc_ctx4), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_spsc_watermark(&q2_spsc_ctx4, 2, 1, test_helper_q2_spsc_watermark_alternate, &watermark), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_spsc_producer, &q2_spsc_ctx4), 0);
+
+    while(expected < TEST_THREADED_ITEM_COUNT)
+    {
+        if(Q2_SUCCESS == q2_spsc_get(&q2_spsc_ctx4, &output))
+        {
+            expected++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(atomic_load(&watermark.alternating));
+    TEST_ASSERT_TRUE(watermark.calls > 0);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_spsc_init_should_InitializeContext);
+    RUN_TEST(test_q2_spsc_init_should_NotInitializeContext);
+    RUN_TEST(test_q2_spsc_should_NotPutOrGet);
+    RUN_TEST(test_q2_spsc_should_FillAndEmptyAcrossWrap);
+    RUN_TEST(test_q2_spsc_should_TransferInOrderBetweenThreads);
+    RUN_TEST(test_q2_spsc_drain_should_TransferInOrderBetweenThreads);
+    RUN_TEST(test_q2_spsc_wait_should_TimeOut);
+    RUN_TEST(test_q2_spsc_wait_should_TransferInOrderBetweenThreads);
+    RUN_TEST(test_q2_spsc_wait_should_WakeOnPlainPut);
+    RUN_TEST(test_q2_spsc_watermark_should_NotSetWatermark);
+    RUN_TEST(test_q2_spsc_watermark_should_SignalOncePerCrossing);
+    RUN_TEST(test_q2_spsc_watermark_should_AlternateBetweenThreads);
+    return UNITY_END();
+}
@@ -14,6 +14,7 @@
 #include "q2.h"
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /**********************************************************
  * Defines
@@ -48,8 +49,6 @@ void test_helper_q2_context_clear(q2_context_t* const ctx)
 {
     memset(ctx->data, 0x00, ctx->item_length * ctx->max_length);
     ctx->initialized = false;
-    ctx->full = false;
-    ctx->empty = true;
     ctx->head = 0;
     ctx->tail = 0;
 }
@@ -63,6 +62,17 @@ void setUp(void)
     test_helper_q2_context_clear(&q2_ctx5);
 }
 
+bool test_helper_q2_drain_record(void* const item, void* const arg)
+{
+    uint32_t* record = arg;
+
+    /* record[0] counts the items seen, the rest hold them in order */
+    record[0]++;
+    record[record[0]] = *(uint32_t*)item;
+
+    return (99 != *(uint32_t*)item);
+}
+
 void test_q2_init_should_InitializeContext(void)
 {
     TEST_ASSERT_EQUAL(q2_init(&q2_ctx1), Q2_SUCCESS);
@@ -87,6 +97,7 @@ void test_q2_reset_should_NotReset(void)
     TEST_ASSERT_EQUAL(q2_reset(NULL), Q2_ERROR_NULL_PARAMETER);
 }
 
+#if defined(Q2_DEBUG_CHECKS)
 void test_q2_put_should_NotPut(void)
 {
     uint32_t input = 0x12345678;
@@ -104,6 +115,7 @@ void test_q2_get_should_NotGet(void)
     TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, NULL), Q2_ERROR_NULL_PARAMETER);
     TEST_ASSERT_EQUAL(q2_get(NULL, &output), Q2_ERROR_NULL_PARAMETER);
 }
+#endif
 
 void test_q2_put_should_PutUntilFull(void)
 {
@@ -119,6 +131,36 @@ void test_q2_put_should_PutUntilFull(void)
     TEST_ASSERT_TRUE(full);
 }
 
+void test_q2_should_WrapFreeRunningIndices(void)
+{
+    uint32_t input[4] = { 1, 2, 3, 4 };
+    uint32_t output[4];
+    uint32_t transferred;
+    uint32_t length;
+    uint32_t i;
+    bool full;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+
+    /* Start two items before the 32 bit counters overflow */
+    q2_ctx2.head = 0xFFFFFFFE;
+    q2_ctx2.tail = 0xFFFFFFFE;
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &input[i]), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(2, q2_ctx2.head);
+    TEST_ASSERT_EQUAL(q2_full(&q2_ctx2, &full), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(full);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+    TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &input[0]), Q2_ERROR_FULL);
+
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, &output[1], 3, true, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL_MEMORY(input, output, sizeof(input));
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output[0]), Q2_ERROR_EMPTY);
+}
+
 void test_q2_get_should_BeEmpty(void)
 {
     uint32_t output;
@@ -129,6 +171,7 @@ void test_q2_get_should_BeEmpty(void)
     TEST_ASSERT_TRUE(empty);
 }
 
+#if defined(Q2_DEBUG_CHECKS)
 void test_q2_empty_should_NotGetEmpty(void)
 {
     bool empty;
@@ -152,6 +195,7 @@ void test_q2_length_should_NotGetLength(void)
     TEST_ASSERT_EQUAL(q2_length(NULL, &length), Q2_ERROR_NULL_PARAMETER);
     TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, NULL), Q2_ERROR_NULL_PARAMETER);
 }
+#endif
 
 void test_q2_should_FillAndEmptyCustomStruct(void)
 {
@@ -303,6 +347,354 @@ void test_q2_should_FillAndEmptyUint8(void)
     TEST_ASSERT_EQUAL(0, length);
 }
 
+void test_q2_put_n_should_NotPutN(void)
+{
+    uint32_t input[2] = { 0 };
+    uint32_t transferred;
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 2, false, &transferred), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, input, 2, false, &transferred), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put_n(NULL, input, 2, false, &transferred), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, NULL, 2, false, &transferred), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 2, false, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_get_n(NULL, input, 2, false, &transferred), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, NULL, 2, false, &transferred), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, input, 2, false, NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_put_n_should_PutPartialOrAllOrNothing(void)
+{
+    uint32_t input[5] = { 0xA, 0xB, 0xC, 0xD, 0xE };
+    uint32_t output[5] = { 0 };
+    uint32_t transferred;
+    uint32_t length;
+    bool full;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+
+    /* All or nothing rejects a batch larger than the free space */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 5, true, &transferred), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(0, transferred);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, length);
+
+    /* Partial transfer fills the queue */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 5, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, transferred);
+    TEST_ASSERT_EQUAL(q2_full(&q2_ctx2, &full), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(full);
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 1, false, &transferred), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(0, transferred);
+
+    /* All or nothing rejects a batch larger than the queued items */
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, output, 3, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, transferred);
+    TEST_ASSERT_EQUAL_MEMORY(input, output, 3 * sizeof(uint32_t));
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, output, 2, true, &transferred), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, transferred);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, output, 5, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, transferred);
+    TEST_ASSERT_EQUAL(input[3], output[0]);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, output, 1, false, &transferred), Q2_ERROR_EMPTY);
+}
+
+void test_q2_put_n_should_SplitAcrossWrap(void)
+{
+    uint8_t input[32];
+    uint8_t output[32];
+    uint32_t transferred;
+    uint32_t length;
+    bool empty;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx3), Q2_SUCCESS);
+
+    for(i = 0; i < 32; i++)
+    {
+        input[i] = (uint8_t)i;
+    }
+
+    /* Move head and tail near the end of the buffer */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx3, input, 28, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx3, output, 28, false, &transferred), Q2_SUCCESS);
+
+    /* 4 items before the wrap, 16 after */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx3, input, 20, true, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(20, transferred);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx3, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(20, length);
+
+    /* Mix with single item gets */
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx3, &output[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx3, &output[1], 19, true, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(19, transferred);
+    TEST_ASSERT_EQUAL_MEMORY(input, output, 20);
+    TEST_ASSERT_EQUAL(q2_empty(&q2_ctx3, &empty), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(empty);
+}
+
+void test_q2_reserve_should_NotReserveOrPeek(void)
+{
+    void* slot;
+    uint32_t count;
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 1, &slot, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_commit(&q2_ctx2, 1), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 1, &slot, &count), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_release(&q2_ctx2, 1), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_reserve(NULL, 1, &slot, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 1, NULL, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 1, &slot, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_commit(NULL, 1), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_peek(NULL, 1, &slot, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 1, NULL, &count), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 1, &slot, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_release(NULL, 1), Q2_ERROR_NULL_PARAMETER);
+
+    /* Nothing to release, no room to commit past capacity */
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 1, &slot, &count), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_release(&q2_ctx2, 1), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_commit(&q2_ctx2, 5), Q2_ERROR_FULL);
+}
+
+void test_q2_reserve_should_ReturnSpansUpToWrap(void)
+{
+    uint32_t* slot;
+    uint32_t count;
+    uint32_t output;
+    uint32_t length;
+    bool full;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+
+    /* Build three items in place */
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 3, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, count);
+    slot[0] = 0xA;
+    slot[1] = 0xB;
+    slot[2] = 0xC;
+    TEST_ASSERT_EQUAL(q2_commit(&q2_ctx2, 3), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(3, length);
+
+    /* Consume two in place */
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 2, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(0xA, slot[0]);
+    TEST_ASSERT_EQUAL(0xB, slot[1]);
+    TEST_ASSERT_EQUAL(q2_release(&q2_ctx2, 2), Q2_SUCCESS);
+
+    /* Three slots free but only one before the wrap */
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 3, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, count);
+    slot[0] = 0xD;
+    TEST_ASSERT_EQUAL(q2_commit(&q2_ctx2, 1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 3, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, count);
+    slot[0] = 0xE;
+    slot[1] = 0xF;
+    TEST_ASSERT_EQUAL(q2_commit(&q2_ctx2, 2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_full(&q2_ctx2, &full), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(full);
+    TEST_ASSERT_EQUAL(q2_reserve(&q2_ctx2, 1, (void**)&slot, &count), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(0, count);
+
+    /* Peek stops at the wrap as well */
+    TEST_ASSERT_EQUAL(q2_peek(&q2_ctx2, 4, (void**)&slot, &count), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(0xC, slot[0]);
+    TEST_ASSERT_EQUAL(0xD, slot[1]);
+    TEST_ASSERT_EQUAL(q2_release(&q2_ctx2, 2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0xE, output);
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0xF, output);
+}
+
+void test_q2_put_overwrite_should_DropOldestWhenFull(void)
+{
+    uint32_t input;
+    uint32_t output;
+    uint32_t overwritten;
+    uint32_t length;
+#if defined(Q2_STATS)
+    q2_stats_t stats;
+#endif
+    TEST_ASSERT_EQUAL(q2_put_overwrite(&q2_ctx2, &input, &overwritten), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put_overwrite(NULL, &input, &overwritten), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_put_overwrite(&q2_ctx2, NULL, &overwritten), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_put_overwrite(&q2_ctx2, &input, NULL), Q2_ERROR_NULL_PARAMETER);
+
+    /* Six puts into four slots drop the two oldest */
+    for(input = 0; input < 6; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_put_overwrite(&q2_ctx2, &input, &overwritten), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL((input < 4) ? 0 : 1, overwritten);
+    }
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, length);
+
+    for(input = 2; input < 6; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(input, output);
+    }
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &output), Q2_ERROR_EMPTY);
+
+#if defined(Q2_STATS)
+    TEST_ASSERT_EQUAL(q2_stats(&q2_ctx2, &stats), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, stats.overwrites);
+#endif
+}
+
+void test_q2_drain_should_HandleItemsInPlace(void)
+{
+    uint32_t input[4] = { 1, 2, 99, 4 };
+    uint32_t record[5];
+    uint32_t transferred;
+    uint32_t drained;
+    uint32_t length;
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_drain(NULL, test_helper_q2_drain_record, record, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, NULL, record, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, Q2_NO_LIMIT, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(0, drained);
+
+    /* Start near the end of the buffer so the batch wraps */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 3, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, input, 3, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, input, 4, false, &transferred), Q2_SUCCESS);
+
+    /* Byte limit smaller than one item drains nothing */
+    record[0] = 0;
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, 3, &drained), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, drained);
+
+    /* Byte limit of two items */
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, 8, &drained), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(2, drained);
+    TEST_ASSERT_EQUAL(1, record[1]);
+    TEST_ASSERT_EQUAL(2, record[2]);
+
+    /* Handler stops after 99, which is still consumed */
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, Q2_NO_LIMIT, Q2_NO_LIMIT, &drained), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, drained);
+    TEST_ASSERT_EQUAL(99, record[3]);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, length);
+
+    TEST_ASSERT_EQUAL(q2_drain(&q2_ctx2, test_helper_q2_drain_record, record, 1, Q2_NO_LIMIT, &drained), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(1, drained);
+    TEST_ASSERT_EQUAL(4, record[4]);
+    TEST_ASSERT_EQUAL(4, record[0]);
+    TEST_ASSERT_EQUAL(q2_length(&q2_ctx2, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, length);
+}
+
+#if defined(Q2_STATS)
+void test_q2_stats_should_NotGetStats(void)
+{
+    q2_stats_t stats;
+    TEST_ASSERT_EQUAL(q2_stats(&q2_ctx2, &stats), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_stats_reset(&q2_ctx2), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_stats(NULL, &stats), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_stats(&q2_ctx2, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_stats_reset(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_stats_should_CountPutsGetsAndRejections(void)
+{
+    uint32_t items[4] = { 1, 2, 3, 4 };
+    uint32_t transferred;
+    q2_stats_t stats;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_stats_reset(&q2_ctx2), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &items[0]), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &items[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, items, 4, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &items[0]), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, items, 3, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &items[0]), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_stats(&q2_ctx2, &stats), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(4, stats.puts);
+    TEST_ASSERT_EQUAL(4, stats.gets);
+    TEST_ASSERT_EQUAL(1, stats.full_rejections);
+    TEST_ASSERT_EQUAL(1, stats.empty_polls);
+    TEST_ASSERT_EQUAL(4, stats.high_watermark);
+
+    /* Reset clears counters and restarts the watermark from the current length */
+    TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &items[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_stats_reset(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_stats(&q2_ctx2, &stats), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, stats.puts);
+    TEST_ASSERT_EQUAL(0, stats.gets);
+    TEST_ASSERT_EQUAL(1, stats.high_watermark);
+}
+#endif
+
+#if defined(Q2_SOJOURN)
+void test_q2_sojourn_should_NotGetPercentile(void)
+{
+    uint64_t value;
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 50.0, &value), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_sojourn_reset(&q2_ctx2), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(NULL, 50.0, &value), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 50.0, NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_sojourn_reset(NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, -1.0, &value), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 100.5, &value), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_sojourn_reset(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 50.0, &value), Q2_ERROR_EMPTY);
+}
+
+void test_q2_sojourn_should_BucketLogLinear(void)
+{
+    /* Exact below 16, then 16 buckets per power of two */
+    TEST_ASSERT_EQUAL(0, q2_sojourn_bucket(0));
+    TEST_ASSERT_EQUAL(15, q2_sojourn_bucket(15));
+    TEST_ASSERT_EQUAL(16, q2_sojourn_bucket(16));
+    TEST_ASSERT_EQUAL(31, q2_sojourn_bucket(31));
+    TEST_ASSERT_EQUAL(32, q2_sojourn_bucket(32));
+    TEST_ASSERT_EQUAL(32, q2_sojourn_bucket(33));
+    TEST_ASSERT_EQUAL(33, q2_sojourn_bucket(34));
+    TEST_ASSERT_EQUAL(48, q2_sojourn_bucket(64));
+    TEST_ASSERT_EQUAL(Q2_SOJOURN_BUCKETS - 1, q2_sojourn_bucket(UINT64_MAX));
+}
+
+void test_q2_sojourn_should_RecordTimeQueued(void)
+{
+    const struct timespec delay = { .tv_sec = 0, .tv_nsec = 2000000 };
+    uint32_t items[4] = { 1, 2, 3, 4 };
+    uint32_t transferred;
+    uint64_t median;
+    uint64_t tail;
+    uint64_t max;
+    TEST_ASSERT_EQUAL(q2_init(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_reset(&q2_ctx2), Q2_SUCCESS);
+
+    /* Three items pass straight through, one waits out the sleep */
+    TEST_ASSERT_EQUAL(q2_put_n(&q2_ctx2, items, 3, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &items[0]), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_get_n(&q2_ctx2, items, 2, false, &transferred), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_put(&q2_ctx2, &items[3]), Q2_SUCCESS);
+    nanosleep(&delay, NULL);
+    TEST_ASSERT_EQUAL(q2_get(&q2_ctx2, &items[0]), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 50.0, &median), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 99.0, &tail), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 100.0, &max), Q2_SUCCESS);
+    TEST_ASSERT_TRUE(median < 1000000);
+    TEST_ASSERT_TRUE(tail >= 2000000);
+    TEST_ASSERT_EQUAL(tail, max);
+
+    TEST_ASSERT_EQUAL(q2_sojourn_reset(&q2_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_sojourn_percentile(&q2_ctx2, 100.0, &max), Q2_ERROR_EMPTY);
+}
+#endif
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -310,15 +702,36 @@ int main(void)
     RUN_TEST(test_q2_init_should_NotInitializeContext);
     RUN_TEST(test_q2_reset_should_Reset);
     RUN_TEST(test_q2_reset_should_NotReset);
+#if defined(Q2_DEBUG_CHECKS)
     RUN_TEST(test_q2_put_should_NotPut);
     RUN_TEST(test_q2_get_should_NotGet);
+#endif
     RUN_TEST(test_q2_put_should_PutUntilFull);
+    RUN_TEST(test_q2_should_WrapFreeRunningIndices);
     RUN_TEST(test_q2_get_should_BeEmpty);
+#if defined(Q2_DEBUG_CHECKS)
     RUN_TEST(test_q2_empty_should_NotGetEmpty);
     RUN_TEST(test_q2_full_should_NotGetFull);
     RUN_TEST(test_q2_length_should_NotGetLength);
+#endif
     RUN_TEST(test_q2_should_FillAndEmptyCustomStruct);
     RUN_TEST(test_q2_should_FillAndEmptyUint32);
     RUN_TEST(test_q2_should_FillAndEmptyUint8);
+    RUN_TEST(test_q2_put_n_should_NotPutN);
+    RUN_TEST(test_q2_put_n_should_PutPartialOrAllOrNothing);
+    RUN_TEST(test_q2_put_n_should_SplitAcrossWrap);
+    RUN_TEST(test_q2_reserve_should_NotReserveOrPeek);
+    RUN_TEST(test_q2_reserve_should_ReturnSpansUpToWrap);
+    RUN_TEST(test_q2_put_overwrite_should_DropOldestWhenFull);
+    RUN_TEST(test_q2_drain_should_HandleItemsInPlace);
+#if defined(Q2_STATS)
+    RUN_TEST(test_q2_stats_should_NotGetStats);
+    RUN_TEST(test_q2_stats_should_CountPutsGetsAndRejections);
+#endif
+#if defined(Q2_SOJOURN)
+    RUN_TEST(test_q2_sojourn_should_NotGetPercentile);
+    RUN_TEST(test_q2_sojourn_should_BucketLogLinear);
+    RUN_TEST(test_q2_sojourn_should_RecordTimeQueued);
+#endif
     return UNITY_END();
 }
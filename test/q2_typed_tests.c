@@ -0,0 +1,103 @@
+/**********************************************************
+ * Name:
+ *     q2_typed_tests.c
+ *
+ * Description:
+ *     Unity tests for type specialized power of two queues.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_typed.h"
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Types
+ *********************************************************/
+typedef struct
+{
+    uint64_t id;
+    uint64_t value;
+} message_t;
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_DEFINE_TYPED(q2_msg, message_t, 4)
+Q2_DEFINE_TYPED(q2_u8, uint8_t, 32)
+
+/**********************************************************
+ * Variables
+ *********************************************************/
+static q2_msg_t q2_msg_ctx;
+static q2_u8_t q2_u8_ctx;
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void setUp(void)
+{
+    memset(&q2_msg_ctx, 0x00, sizeof(q2_msg_ctx));
+    memset(&q2_u8_ctx, 0x00, sizeof(q2_u8_ctx));
+}
+
+void test_q2_typed_should_FillAndEmptyStruct(void)
+{
+    message_t input = { .id = 0, .value = 0xBEEF };
+    message_t output;
+    uint32_t i;
+    uint32_t j;
+
+    /* Go around the ring several times to exercise the free running indices */
+    for(i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_TRUE(q2_msg_empty(&q2_msg_ctx));
+        TEST_ASSERT_EQUAL(q2_msg_get(&q2_msg_ctx, &output), Q2_ERROR_EMPTY);
+        for(j = 0; j < 4; j++)
+        {
+            TEST_ASSERT_EQUAL(q2_msg_put(&q2_msg_ctx, input), Q2_SUCCESS);
+            input.id++;
+        }
+        TEST_ASSERT_TRUE(q2_msg_full(&q2_msg_ctx));
+        TEST_ASSERT_EQUAL(4, q2_msg_length(&q2_msg_ctx));
+        TEST_ASSERT_EQUAL(q2_msg_put(&q2_msg_ctx, input), Q2_ERROR_FULL);
+
+        for(j = 4; j > 0; j--)
+        {
+            TEST_ASSERT_EQUAL(q2_msg_get(&q2_msg_ctx, &output), Q2_SUCCESS);
+            TEST_ASSERT_EQUAL(input.id - j, output.id);
+            TEST_ASSERT_EQUAL(0xBEEF, output.value);
+        }
+        TEST_ASSERT_FALSE(q2_msg_full(&q2_msg_ctx));
+    }
+}
+
+void test_q2_typed_should_Reset(void)
+{
+    uint8_t input;
+    uint8_t output;
+
+    for(input = 0; input < 32; input++)
+    {
+        TEST_ASSERT_EQUAL(q2_u8_put(&q2_u8_ctx, input), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_u8_put(&q2_u8_ctx, input), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_u8_get(&q2_u8_ctx, &output), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, output);
+
+    q2_u8_reset(&q2_u8_ctx);
+    TEST_ASSERT_EQUAL(0, q2_u8_length(&q2_u8_ctx));
+    TEST_ASSERT_EQUAL(q2_u8_get(&q2_u8_ctx, &output), Q2_ERROR_EMPTY);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_typed_should_FillAndEmptyStruct);
+    RUN_TEST(test_q2_typed_should_Reset);
+    return UNITY_END();
+}
@@ -0,0 +1,209 @@
+/**********************************************************
+ * Name:
+ *     q2_varlen_tests.c
+ *
+ * Description:
+ *     Unity tests for variable length message queue.
+ *
+ * Copyright (c) 2017 Matthew Sembinelli
+ *********************************************************/
+/**********************************************************
+ * Includes
+ *********************************************************/
+#include "unity.h"
+#include "q2_varlen.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************
+ * Defines
+ *********************************************************/
+#define TEST_THREADED_MESSAGE_COUNT (100000)
+#define TEST_MESSAGE_MAX            (500)
+
+/**********************************************************
+ * Macros
+ *********************************************************/
+Q2_VARLEN(q2_varlen_ctx1, 64);
+Q2_VARLEN(q2_varlen_ctx2, 4096);
+
+// Invalid size initializer (not power of two)
+Q2_VARLEN(q2_varlen_ctx3, 48);
+
+/**********************************************************
+ * Procedures
+ *********************************************************/
+void test_helper_q2_varlen_context_clear(q2_varlen_context_t* const ctx)
+{
+    memset(ctx->data, 0x00, ctx->buffer_length);
+    ctx->initialized = false;
+}
+
+void setUp(void)
+{
+    test_helper_q2_varlen_context_clear(&q2_varlen_ctx1);
+    test_helper_q2_varlen_context_clear(&q2_varlen_ctx2);
+    test_helper_q2_varlen_context_clear(&q2_varlen_ctx3);
+}
+
+/* Message i is (i * 7) % TEST_MESSAGE_MAX bytes, each byte set to i */
+uint32_t test_helper_q2_varlen_fill(uint8_t* const message, uint32_t i)
+{
+    uint32_t length = (i * 7) % TEST_MESSAGE_MAX;
+    memset(message, (uint8_t)i, length);
+    return length;
+}
+
+void* test_helper_q2_varlen_producer(void* arg)
+{
+    uint8_t message[TEST_MESSAGE_MAX];
+    uint32_t length;
+    uint32_t i;
+    (void)arg;
+
+    for(i = 0; i < TEST_THREADED_MESSAGE_COUNT; i++)
+    {
+        length = test_helper_q2_varlen_fill(message, i);
+        while(Q2_ERROR_FULL == q2_varlen_put(&q2_varlen_ctx2, message, length))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+void test_q2_varlen_init_should_InitializeContext(void)
+{
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx3), Q2_ERROR_LENGTH_NOT_POWER_OF_TWO);
+    TEST_ASSERT_EQUAL(q2_varlen_init(NULL), Q2_ERROR_NULL_PARAMETER);
+}
+
+void test_q2_varlen_should_NotPutOrGet(void)
+{
+    uint8_t message[64] = { 0 };
+    uint32_t length;
+    void* slot;
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, message, 4), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, message, sizeof(message), &length), Q2_ERROR_NOT_INITIALIZED);
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_put(NULL, message, 4), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, NULL, 4), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, NULL, sizeof(message), &length), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, message, sizeof(message), NULL), Q2_ERROR_NULL_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_commit(&q2_varlen_ctx1, 0), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_release(&q2_varlen_ctx1), Q2_ERROR_EMPTY);
+
+    /* Half the buffer less the header is the longest message */
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, message, Q2_VARLEN_MAX_MESSAGE(64) + 1), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(q2_varlen_reserve(&q2_varlen_ctx1, Q2_VARLEN_MAX_MESSAGE(64), &slot), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_commit(&q2_varlen_ctx1, Q2_VARLEN_MAX_MESSAGE(64) + 1), Q2_ERROR_INVALID_PARAMETER);
+}
+
+void test_q2_varlen_should_PackMixedLengthsAcrossWrap(void)
+{
+    uint8_t input[28];
+    uint8_t output[28];
+    uint32_t length;
+    uint32_t used;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx1), Q2_SUCCESS);
+
+    for(i = 0; i < 40; i++)
+    {
+        memset(input, (uint8_t)i, sizeof(input));
+        TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, input, i % sizeof(input)), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, output, sizeof(output), &length), Q2_SUCCESS);
+        TEST_ASSERT_EQUAL(i % sizeof(input), length);
+        TEST_ASSERT_EQUAL_MEMORY(input, output, length);
+    }
+    TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, output, sizeof(output), &length), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_varlen_used(&q2_varlen_ctx1, &used), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(0, used);
+
+    /* Frames are packed, five 8 byte messages take 60 of the 64 bytes */
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx1), Q2_SUCCESS);
+    for(i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, input, 8), Q2_SUCCESS);
+    }
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, input, 0), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, input, 0), Q2_ERROR_FULL);
+    TEST_ASSERT_EQUAL(q2_varlen_used(&q2_varlen_ctx1, &used), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(64, used);
+}
+
+void test_q2_varlen_should_ReserveAndPeekInPlace(void)
+{
+    uint8_t output[32];
+    uint32_t length;
+    uint8_t* slot;
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx1), Q2_SUCCESS);
+
+    /* Leave 8 bytes before the wrap so the next frame pads */
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, output, 20), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_put(&q2_varlen_ctx1, output, 28), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_release(&q2_varlen_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_release(&q2_varlen_ctx1), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_varlen_reserve(&q2_varlen_ctx1, 24, (void**)&slot), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL_PTR(q2_varlen_ctx1.data + Q2_VARLEN_HEADER_LENGTH, slot);
+    memcpy(slot, "contiguous", 10);
+    TEST_ASSERT_EQUAL(q2_varlen_peek(&q2_varlen_ctx1, (void**)&slot, &length), Q2_ERROR_EMPTY);
+    TEST_ASSERT_EQUAL(q2_varlen_commit(&q2_varlen_ctx1, 10), Q2_SUCCESS);
+
+    TEST_ASSERT_EQUAL(q2_varlen_get(&q2_varlen_ctx1, output, 4, &length), Q2_ERROR_INVALID_PARAMETER);
+    TEST_ASSERT_EQUAL(10, length);
+    TEST_ASSERT_EQUAL(q2_varlen_peek(&q2_varlen_ctx1, (void**)&slot, &length), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(10, length);
+    TEST_ASSERT_EQUAL_MEMORY("contiguous", slot, 10);
+    TEST_ASSERT_EQUAL(q2_varlen_release(&q2_varlen_ctx1), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(q2_varlen_peek(&q2_varlen_ctx1, (void**)&slot, &length), Q2_ERROR_EMPTY);
+}
+
+void test_q2_varlen_should_TransferInOrderBetweenThreads(void)
+{
+    pthread_t producer;
+    uint8_t expected[TEST_MESSAGE_MAX];
+    uint8_t output[TEST_MESSAGE_MAX];
+    uint32_t expected_length;
+    uint32_t length;
+    uint32_t i = 0;
+    bool in_order = true;
+    TEST_ASSERT_EQUAL(q2_varlen_init(&q2_varlen_ctx2), Q2_SUCCESS);
+    TEST_ASSERT_EQUAL(pthread_create(&producer, NULL, test_helper_q2_varlen_producer, NULL), 0);
+
+    while(i < TEST_THREADED_MESSAGE_COUNT)
+    {
+        if(Q2_SUCCESS == q2_varlen_get(&q2_varlen_ctx2, output, sizeof(output), &length))
+        {
+            expected_length = test_helper_q2_varlen_fill(expected, i);
+            if(expected_length != length || 0 != memcmp(expected, output, length))
+            {
+                in_order = false;
+            }
+            i++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    TEST_ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    TEST_ASSERT_TRUE(in_order);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_q2_varlen_init_should_InitializeContext);
+    RUN_TEST(test_q2_varlen_should_NotPutOrGet);
+    RUN_TEST(test_q2_varlen_should_PackMixedLengthsAcrossWrap);
+    RUN_TEST(test_q2_varlen_should_ReserveAndPeekInPlace);
+    RUN_TEST(test_q2_varlen_should_TransferInOrderBetweenThreads);
+    return UNITY_END();
+}